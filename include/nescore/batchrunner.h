@@ -0,0 +1,77 @@
+#ifndef SCHPUNE_NESCORE_BATCHRUNNER_H_INCLUDED
+#define SCHPUNE_NESCORE_BATCHRUNNER_H_INCLUDED
+
+#include <memory>
+#include <vector>
+#include <functional>
+#include "schpunetypes.h"
+#include "nesfile.h"
+#include "frameoptions.h"
+
+namespace schcore
+{
+    class Nes;
+
+    struct BatchStats
+    {
+        u64             frames = 0;             // instance-frames run (every instance's frames, added up)
+        double          seconds = 0;            // time spent in run()
+        double          framesPerSecond = 0;    // frames / seconds -- for all instances together
+        std::size_t     instanceMemory = 0;     // average bytes used by each instance (see Nes::getMemoryUsage)
+        std::size_t     sharedMemory = 0;       // ROM bytes shared by all of them
+    };
+
+    //////////////////////////////////////////////
+    //  BatchRunner
+    //    Runs lots of copies of one game at once (for automated testing, etc).  The file is loaded once and its
+    //  ROM is shared read-only by every instance (see NesFile::shareRom), so each one only has its own RAM and
+    //  state.
+    //
+    //    run() spreads instance-frames over a pool of worker threads.  Each worker has its own queue of
+    //  instances:  it runs one frame of the one at the front and puts it on the back, and when its queue runs
+    //  dry it steals from the back of another's.  So the load stays balanced even when some instances are much
+    //  slower than others, and an instance only ever runs on one thread at a time, with its frames in order.
+    //
+    //    The callback is called on the worker thread right after each frame an instance runs ('frame' counts from
+    //  0 at the start of each run).  It can set the input for the next frame, look at the video/audio (any audio
+    //  left over afterward is thrown away), and returns false to stop that instance for the rest of the run.
+    //  It's only ever called for one frame of a given instance at a time, but calls for different instances
+    //  happen at the same time.  If it (or the emulation) throws, the run stops and run() rethrows the first
+    //  exception.
+    //
+    //    Input devices are set on each instance with getInstance(i).setInputDevice, as normal.
+
+    class BatchRunner
+    {
+    public:
+        typedef std::function<bool(Nes& nes, int instance, int frame)>     FrameCallback;
+
+                            BatchRunner(NesFile&& file, int threads = 0);       // threads:  0 = one per core
+                            BatchRunner(const char* filename, int threads = 0);
+                            ~BatchRunner();
+
+        int                 addInstances(int count);                            // returns the index of the first new one
+        int                 getInstanceCount() const            { return static_cast<int>(instances.size());       }
+        Nes&                getInstance(int index)              { return *instances[index];                         }
+        int                 getThreadCount() const;
+
+        void                run(int frames, const FrameOptions& options = FrameOptions(), const FrameCallback& callback = nullptr);
+
+        BatchStats          getStats() const;
+        void                clearStats();
+
+    private:
+        struct Pool;
+
+        NesFile                             file;
+        std::vector<std::unique_ptr<Nes>>   instances;
+        std::unique_ptr<Pool>               pool;
+        u64                                 framesRun = 0;
+        double                              secondsRun = 0;
+
+                            BatchRunner(const BatchRunner&) = delete;
+        BatchRunner&        operator = (const BatchRunner&) = delete;
+    };
+}
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef SCHPUNE_NESCORE_FRAMEOPTIONS_H_INCLUDED
+#define SCHPUNE_NESCORE_FRAMEOPTIONS_H_INCLUDED
+
+namespace schcore
+{
+    //////////////////////////////////////////////
+    //  Per-frame options for Nes::doFrame
+    //    These only control what output is produced.  The emulation itself (including everything the game
+    //  can see, like sprite 0 hit and the cartridge's view of PPU fetches) is exactly the same either way.
+
+    struct FrameOptions
+    {
+        bool        video = true;               // false = don't draw pixels.  The video buffer is left as it was.
+        bool        audio = true;               // false = don't synthesize audio.  No audio is produced for the frame --
+                                                //   when it's turned back on, audio picks up where it left off.
+    };
+}
+
+#endif
@@ -7,6 +7,7 @@
 namespace schcore
 {
     class Nes;
+    class StateStream;
     namespace input
     {
         class InputDevice
@@ -16,11 +17,12 @@ namespace schcore
         private:
             ///////////////////////////////////
             // interface for the Nes
-            friend class Nes;
+            friend class ::schcore::Nes;
             virtual void            hardReset() = 0;
             virtual void            connect() = 0;
             virtual void            write(u8 v) = 0;
             virtual u8              read() = 0;
+            virtual void            serialize(StateStream&) { }
         };
 
         ///////////////////////////////////////////////////////////////
@@ -40,12 +42,14 @@ namespace schcore
                 Btn_Right =     (1<<7)
             };
             void            setState(int v, bool dpad_protect = true);
+            int             getState() const        { return state;     }
 
         private:
             virtual void            hardReset() override    { latch = 0; strobe_bit = false;    }
             virtual void            connect() override      { }
             virtual void            write(u8 v) override;
             virtual u8              read() override;
+            virtual void            serialize(StateStream& s) override;
 
             u8              state = 0;
             u8              latch = 0;
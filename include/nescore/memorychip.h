@@ -3,6 +3,8 @@
 #define SCHPUNE_NESCORE_MEMORYCHIP_H_INCLUDED
 
 #include <vector>
+#include <memory>
+#include <algorithm>
 #include "schpunetypes.h"
 #include "error.h"
 
@@ -10,8 +12,8 @@ namespace schcore
 {
     struct ChipPage
     {
-        static const bool alwaysTrue  = true;
-        static const bool alwaysFalse = false;
+        static const bool alwaysTrue;           // (defined in memorychip.cpp)
+        static const bool alwaysFalse;
 
         u8*             mem =       nullptr;
         const bool*     readable =  &alwaysFalse;
@@ -23,6 +25,12 @@ namespace schcore
         int             memPeek(u16 a) const        { return (*readable ? mem[a & mask] : -1);  }
     };
 
+    //////////////////////////////////////////////
+    //  MemoryChip
+    //    A chip's memory is normally its own, and copying the chip copies it.  share() turns that off for ROM:
+    //  copies of a shared chip all point at the same memory (which is never written), so any number of NesFiles
+    //  and Nes objects can use one copy of a game's ROM.  Only chips that aren't writable can be shared.
+
     class MemoryChip
     {
     public:
@@ -35,6 +43,23 @@ namespace schcore
         {
         }
 
+        MemoryChip(const MemoryChip& rhs)
+            : readable(rhs.readable), writable(rhs.writable), hasBattery(rhs.hasBattery)
+            , data( (rhs.shared || !rhs.data) ? rhs.data : std::make_shared<std::vector<u8>>(*rhs.data) )
+            , mask(rhs.mask), shared(rhs.shared)
+        {
+        }
+
+        MemoryChip& operator = (const MemoryChip& rhs)
+        {
+            if(this != &rhs)
+                *this = MemoryChip(rhs);
+            return *this;
+        }
+
+        MemoryChip(MemoryChip&&) = default;
+        MemoryChip& operator = (MemoryChip&&) = default;
+
         MemoryChip(std::vector<u8>&& d, bool writ = false)
         {
             adoptDataFromVector( std::move(d) );
@@ -51,14 +76,22 @@ namespace schcore
             hasBattery = bat;
         }
 
-        std::size_t         getSize() const         { return data.size();       }
-        const u8*           getData() const         { return &data[0];          }
-        u8*                 getData()               { return &data[0];          }
+        std::size_t         getSize() const         { return data ? data->size() : 0;           }
+        const u8*           getData() const         { return data ? data->data() : nullptr;     }
+        u8*                 getData()               { return data ? data->data() : nullptr;     }
+        bool                isShared() const        { return shared;                            }
+
+        void                share()
+        {
+            if(writable)                throw Error("Internal error:  only read-only chips can be shared");
+            shared = true;
+        }
 
         void                adoptDataFromVector(std::vector<u8>&& d)
         {
-            data = std::move(d);
-            setSize(data.size());
+            data = std::make_shared<std::vector<u8>>( std::move(d) );
+            shared = false;
+            setSize(data->size());
         }
 
         void                setSize(std::size_t siz)
@@ -74,18 +107,23 @@ namespace schcore
                 actualsize <<= 1;
             mask = actualsize - 1;
 
-            data.resize(actualsize);
+            if(!data || shared)
+            {
+                data = std::make_shared<std::vector<u8>>( data ? *data : std::vector<u8>() );
+                shared = false;
+            }
+            data->resize(actualsize);
         }
 
         ChipPage    get4kPage(unsigned page)
         {
             ChipPage pg;
-            if(data.empty())            return pg;
+            if(!getSize())              return pg;
 
             pg.readable =   &readable;
             pg.writable =   &writable;
             pg.mask =       0x0FFF & mask;
-            pg.mem =        &data[(page << 12) & mask];
+            pg.mem =        getData() + ((page << 12) & mask);
             return pg;
         }
         
@@ -93,23 +131,25 @@ namespace schcore
         ChipPage    get1kPage(unsigned page)
         {
             ChipPage pg;
-            if(data.empty())            return pg;
+            if(!getSize())              return pg;
 
             pg.readable =   &readable;
             pg.writable =   &writable;
             pg.mask =       0x03FF & mask;
-            pg.mem =        &data[(page << 10) & mask];
+            pg.mem =        getData() + ((page << 10) & mask);
             return pg;
         }
 
         void        clear(u8 v = 0)
         {
-            for(auto&i : data)      i = v;
+            if(data && !shared)
+                std::fill(data->begin(), data->end(), v);
         }
 
     private:
-        std::vector<u8>     data;
-        std::size_t         mask = 0;
+        std::shared_ptr<std::vector<u8>>    data;
+        std::size_t                         mask = 0;
+        bool                                shared = false;
     };
 }
 
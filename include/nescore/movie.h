@@ -0,0 +1,96 @@
+#ifndef SCHPUNE_NESCORE_MOVIE_H_INCLUDED
+#define SCHPUNE_NESCORE_MOVIE_H_INCLUDED
+
+#include <iosfwd>
+#include <vector>
+#include "schpunetypes.h"
+
+namespace schcore
+{
+    class Nes;
+    namespace input { class Controller; }
+
+    //////////////////////////////////////////////
+    //  Movie
+    //    Records the input given to the system every frame (controllers, resets, NSF track changes), and plays
+    //  it back bit-exactly.  Movies always start from a hard reset.
+    //
+    //    Each frame also gets a hash of system RAM, the video buffer, and the audio that frame produced.  On
+    //  playback these are checked, and the first frame that doesn't match is reported -- so a movie doubles as
+    //  a regression test for anything that changes emulation.  Hashing is a few microseconds a frame, so it's
+    //  always on.  The video is hashed as it's drawn (see Nes::setVideoTarget), so play a movie back with the
+    //  same video format and palette it was recorded with, or every frame will look like a desync.
+    //
+    //    While a movie is recording or playing, run the system through the Movie (doFrame, getAudio, resets,
+    //  nsf_setTrack) instead of through the Nes, so everything is captured and the audio can be hashed.  Calls
+    //  to the resets and nsf_setTrack are ignored during playback (the movie's own are used).
+
+    class Movie
+    {
+    public:
+        enum class Command : u8
+        {   None, SoftReset, HardReset, SetTrack    };
+
+        struct Frame
+        {
+            u8              buttons[2] = {};            // controller state for each port
+            Command         command = Command::None;     // done just before the frame is run
+            u8              track = 0;                  // for Command::SetTrack
+            u64             hash = 0;                   // RAM, video and audio at the end of the frame
+        };
+
+                            Movie(Nes& nes, input::Controller* port0, input::Controller* port1 = nullptr);
+
+        void                startRecording();           // both of these hard reset the system
+        void                startPlayback();
+        void                stop();
+
+        bool                isRecording() const         { return mode == Mode::Recording;               }
+        bool                isPlaying() const           { return mode == Mode::Playing;                 }
+
+        //////////////////////////////////////
+        //  Running
+        void                doFrame();
+        int                 getAvailableAudioSize() const   { return static_cast<int>(audio.size());    }
+        int                 getAudio(void* bufa, int siza, void* bufb, int sizb);
+
+        void                softReset();
+        void                hardReset();
+        void                nsf_setTrack(int track);
+
+        //////////////////////////////////////
+        //  Info
+        int                 getFrameCount() const       { return static_cast<int>(frames.size());       }
+        int                 getCurrentFrame() const     { return curFrame;                              }
+        int                 getDesyncFrame() const      { return desyncFrame;                           }   // first frame that didn't match on playback, or -1
+        const std::vector<Frame>&   getFrames() const   { return frames;                                }
+
+        //////////////////////////////////////
+        //  Files
+        void                save(std::ostream& file) const;
+        void                load(std::istream& file);   // throws Error
+
+    private:
+        enum class Mode
+        {   Idle, Recording, Playing    };
+
+        Nes&                nes;
+        input::Controller*  ports[2];
+
+        Mode                mode = Mode::Idle;
+        std::vector<Frame>  frames;
+        int                 curFrame = 0;
+        int                 desyncFrame = -1;
+        u8                  startTrack = 0;             // NSF track when recording started
+
+        Command             pendingCommand = Command::None;
+        u8                  pendingTrack = 0;
+
+        std::vector<u8>     audio;                      // produced, but not yet taken with getAudio
+
+        void                doCommand(Command cmd, u8 track);
+        u64                 hashFrame();
+    };
+}
+
+#endif
@@ -9,6 +9,9 @@
 #include "nesfile.h"
 #include "inputdevice.h"
 #include "audiosettings.h"
+#include "runstats.h"
+#include "frameoptions.h"
+#include "videoformat.h"
 
 namespace schcore
 {
@@ -26,6 +29,7 @@ namespace schcore
     class NsfDriver;
     class Cartridge;
     class CpuTracer;
+    class StateStream;
 
     ////////////////////////////////////////
     //  The NES!
@@ -45,7 +49,7 @@ namespace schcore
         void            loadFile(const char* filename);
         void            loadFile(std::istream& file);
 
-        void            copyAndLoadFile(NesFile file)       { loadFile(std::move(file));    }   // makes a copy, owns the copy
+        void            copyAndLoadFile(NesFile file)       { loadFile(std::move(file));    }   // makes a copy, owns the copy (shared ROM stays shared -- see NesFile::shareRom)
         void            hardReset()                         { reset(true);                  }
         void            softReset()                         { reset(false);                 }
         void            reset(bool hard);
@@ -60,14 +64,85 @@ namespace schcore
         int             getApproxNaturalAudioSize() const;
         int             getAvailableAudioSize() const;
 
-        void            doFrame();
+        void            doFrame()                           { doFrame(FrameOptions());      }
+        void            doFrame(const FrameOptions& options);
         int             getAudio(void* bufa, int siza, void* bufb, int sizb);
         const u16*      getVideoBuffer();
+        const u8*       getSystemRam() const                { return systemRam.get();       }   // 0x800 bytes
 
         void            setTracer(std::ostream* stream);
 
         AudioSettings   getAudioSettings() const;
         void            setAudioSettings(const AudioSettings& stgs);
+
+        RunStats        getRunStats() const;
+        void            clearRunStats();
+        std::size_t     getMemoryUsage() const;             // roughly how much memory this Nes uses.  Shared ROM isn't counted (see NesFile::shareRom)
+
+        //////////////////////////////////////////////
+        //  Run-ahead
+        //    Hides the game's own input lag.  Each doFrame runs the real frame (which is where the audio comes
+        //  from), then runs 'frames' more with the same input and shows the video of the last one, then goes
+        //  back to the end of the real frame.  Costs a save and load state plus the extra frames (which have
+        //  no audio, and only the last has video).  Has no effect on NSFs, or on frames run without video.
+        void            setRunAhead(int frames);
+        int             getRunAhead() const                 { return runAheadFrames;        }
+
+        //////////////////////////////////////////////
+        //  Video output
+        //    Normally the PPU draws palette indexes (VideoFormat::Index) into its own buffer, which is what
+        //  getVideoBuffer returns.  setVideoTarget has it draw straight into caller memory instead, already in
+        //  'format', so there's no copy or conversion pass afterwards.  'mem' has to hold 240 rows of 256 pixels,
+        //  'pitch' bytes apart (negative for bottom-up), and stay valid until the target is changed.  Null 'mem'
+        //  goes back to the internal buffer.  While a target is set, getVideoBuffer returns null.
+        //
+        //    The RGB formats come from setVideoPalette:  0x200 RGB triplets, one for each index + emphasis
+        //  combination.  Null goes back to the built-in palette.
+        //
+        //    getVideoOutput returns wherever frames are going right now -- the target if one is set, otherwise
+        //  the internal buffer -- along with its pitch and format.
+        void            setVideoTarget(void* mem, int pitch, VideoFormat format);
+        void            setVideoPalette(const u8* rgb);
+        const void*     getVideoOutput(int& pitch, VideoFormat& format) const;
+
+        //////////////////////////////////////////////
+        //  CHR cache
+        //    The renderer normally takes CHR pixels from a cache of already decoded pages instead of reading
+        //  them through the mapper (mappers that need to see CHR reads never use it).  The output is the same
+        //  either way -- turning it off is only useful for checking that.
+        void            setChrCacheEnabled(bool on);
+        bool            isChrCacheEnabled() const;
+
+        //////////////////////////////////////////////
+        //  Save states
+        //    A snapshot of the whole running system, written to / read from a caller-provided buffer in a
+        //  versioned, fixed-layout binary format.  Cheap enough to take every frame.  The video buffer, audio
+        //  settings and the file itself aren't included.  A state can only be loaded into the same game with
+        //  the same ports connected.  If loading fails partway through, the system is hard reset.
+        std::size_t     getStateSize();                                     // bytes needed by saveState
+        std::size_t     saveState(void* buffer, std::size_t size);          // returns bytes written
+        void            loadState(const void* buffer, std::size_t size);
+
+        //////////////////////////////////////////////
+        //  Cloning
+        //    copyStateFrom makes this Nes an exact copy of 'other' -- like a saveState/loadState between them,
+        //  but without the caller's buffer or the header checks.  If this one isn't already running the same
+        //  game, a copy of other's file is loaded first (shared ROM stays shared -- see NesFile::shareRom), and
+        //  that is the only time anything gets hooked up.  After that, copies only move the running state over
+        //  (a few microseconds), so for searches that branch a lot, keep a pool of Nes objects and copy into
+        //  them rather than making new ones.
+        //
+        //    Both have to have the same input ports connected.  The devices' states are copied too, except for a
+        //  device both of them are using, which is left alone.  As with save states, the video buffer isn't
+        //  copied, and buffered audio is dropped if the audio formats differ.  'other' isn't changed, so several
+        //  threads can copyStateFrom the same Nes at once, each into a Nes with its own input devices.
+        //
+        //    clone() makes a new Nes with the same audio settings, run-ahead, CHR cache setting and input devices,
+        //  and copies this one into it (without touching those devices).  Give it its own devices with
+        //  setInputDevice before running both.  It has to build and hook up a whole new Nes, so it's far slower
+        //  than copying into one that already exists.
+        void                    copyStateFrom(const Nes& other);
+        std::unique_ptr<Nes>    clone() const;
         
         static const int    videoWidth = 256;
         static const int    videoHeight = 240;
@@ -99,9 +174,20 @@ namespace schcore
         // other stuff on the system
         std::unique_ptr<u8[]>           systemRam;
         timestamp_t                     clocksPerFrame;
+        timestamp_t                     frameStart = 0;     // always 0 unless timestamps are monotonic (see schpunetypes.h)
+        u32                             fileHash = 0;       // identifies the loaded game in save states
+        int                             runAheadFrames = 0;
+        std::vector<u8>                 runAheadState;
+        std::vector<u8>                 copyState;          // for copyStateFrom
+
+        /////////////////////////////////////////
+        void            serializeStateHeader(StateStream& s, u32& size);
+        void            serializeState(StateStream& s, bool devices = true);     // devices = include the input devices
 
         /////////////////////////////////////////
+        void            loadFile(NesFile&& file, u32 hash);
         void            fillResetInfo();
+        void            runFrame();
 
         /////////////////////////////////////////
         //  callbacks
@@ -64,6 +64,10 @@ namespace schcore
         std::string         loadFile(const char* filename);
         std::string         loadFile(std::istream& file);
 
+        //  Shares the ROM chips (see MemoryChip::share), so copies of this file -- and every Nes they're loaded
+        //  into -- use this one copy of the ROM instead of their own.  RAM is still copied.
+        void                shareRom();
+
     private:
         void                internal_loadFile(std::istream& file);
         void                internal_loadFile_ines(std::istream& file, int bytes_skipped);
@@ -0,0 +1,75 @@
+#ifndef SCHPUNE_NESCORE_NTSCFILTER_H_INCLUDED
+#define SCHPUNE_NESCORE_NTSCFILTER_H_INCLUDED
+
+#include <vector>
+#include "schpunetypes.h"
+#include "videoformat.h"
+
+namespace schcore
+{
+    //////////////////////////////////////////////
+    //  NTSC filter settings
+
+    struct NtscSettings
+    {
+        int         width = 602;            // output pixels per row.  602 is native (7 for every 3 NES pixels), others are resampled
+        float       hue = 0;                // in degrees
+        float       saturation = 1;
+        float       contrast = 1;
+        float       brightness = 0;         // -1 to 1
+        bool        mergeFields = false;    // blend the two phases a frame alternates between (no dot crawl, a bit softer)
+    };
+
+    //////////////////////////////////////////////
+    //  NtscFilter
+    //    Turns a frame of palette indexes (VideoFormat::Index -- what getVideoBuffer gives, emphasis bits and all)
+    //  into what a TV would show from the NES's composite output:  the PPU's signal is simulated and decoded
+    //  again, so you get the same color fringes, blur and dot crawl the games were drawn for.
+    //
+    //    Decoding is linear, so each NES pixel just adds a fixed smear of color to the output pixels around it.
+    //  That smear only depends on the pixel's index, where it falls in the color subcarrier, and where it sits
+    //  between output pixels, so all of them are worked out up front (in the ctor and setSettings) and filtering
+    //  is only adding them up -- with SSE2 when it's available.
+    //
+    //    Rows don't depend on each other, and filter() doesn't change the filter, so a frame can be split into
+    //  row ranges and filtered on several threads at once.
+
+    class NtscFilter
+    {
+    public:
+        static const int    nativeWidth = 602;
+
+                            NtscFilter(VideoFormat format, const NtscSettings& settings = NtscSettings());
+
+        void                setSettings(const NtscSettings& settings);
+        const NtscSettings& getSettings() const         { return settings;          }
+        VideoFormat         getFormat() const           { return format;            }
+        int                 getWidth() const            { return settings.width;    }
+
+        //  'src' is 256 index pixels per row, 'dst' gets getWidth() pixels per row in the filter's format.  Pitches
+        //  are in bytes (and can be negative).  Only rows 'firstrow' to 'firstrow + rows - 1' are filtered.
+        //
+        //  'phase' is where the subcarrier is at the start of the frame.  It alternates between two values
+        //  from one frame to the next on a real NES, so passing the frame number & 1 gives the usual dot crawl.
+        void                filter(const u16* src, int srcpitch, void* dst, int dstpitch, int phase,
+                                   int firstrow = 0, int rows = 240) const;
+
+    private:
+        struct Resample
+        {
+            int             pos;                // native output pixel to the left
+            float           frac;               // how far toward the next one
+        };
+
+        VideoFormat             format;
+        NtscSettings            settings;
+        std::vector<float>      kernels;        // [row phase][pixel in its group of 3][index][tap][R,G,B,unused]
+        std::vector<Resample>   resample;       // one per output pixel, rounded up to a multiple of 4.  Empty at the native width
+
+        void                build();
+        template <VideoFormat F>
+        void                writeRow(u8* out, const float* acc) const;
+    };
+}
+
+#endif
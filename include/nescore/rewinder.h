@@ -0,0 +1,60 @@
+#ifndef SCHPUNE_NESCORE_REWINDER_H_INCLUDED
+#define SCHPUNE_NESCORE_REWINDER_H_INCLUDED
+
+#include <deque>
+#include <vector>
+#include "schpunetypes.h"
+
+namespace schcore
+{
+    class Nes;
+
+    //////////////////////////////////////////////
+    //  Rewinder
+    //    Keeps a history of the last N frames of save states so the game can be run backwards.  Call capture()
+    //  once after every doFrame, and stepBack() (instead of capture) for each frame you want to go back.
+    //
+    //    Only the newest state is kept whole.  Every older frame is stored as the XOR of it and the frame after
+    //  it, run-length encoded -- nearly all of a state (RAM, nametables, PRG-RAM, etc) is unchanged from one frame
+    //  to the next, so these are usually a small fraction of a full state.  Since rewinding always walks back from
+    //  the newest state, each step is just undoing one of these.  If the state size ever changes (audio settings
+    //  changed, etc), that frame is stored whole instead.
+    //
+    //    The oldest frames are dropped when either the frame limit or the memory budget is exceeded.
+    //
+    //    The video buffer isn't part of a save state, so after stepBack() the frontend should run a frame to get
+    //  a picture for it (and not capture that frame).
+
+    class Rewinder
+    {
+    public:
+                        Rewinder(Nes& nes, int maxframes = 60 * 10, std::size_t memorybudget = 32 * 1024 * 1024);
+
+        void            capture();                          // record the current state
+        bool            stepBack();                         // load the previous recorded state (false if there isn't one)
+        void            clear();
+
+        int             getFrameCount() const               { return static_cast<int>(history.size()) + (head.empty() ? 0 : 1);    }
+        std::size_t     getMemoryUsage() const              { return memUsed + head.capacity() + scratch.capacity();              }
+
+    private:
+        struct Entry
+        {
+            std::vector<u8>     data;
+            bool                whole;          // true if 'data' is the full state rather than a delta
+        };
+
+        Nes&                    nes;
+        int                     maxFrames;
+        std::size_t             memBudget;
+        std::size_t             memUsed = 0;        // data in 'history'
+
+        std::vector<u8>         head;               // newest state, whole
+        std::vector<u8>         scratch;            // where the next state is saved
+        std::deque<Entry>       history;            // older frames, oldest first
+
+        void                    dropOldest(std::vector<u8>& recycle);
+    };
+}
+
+#endif
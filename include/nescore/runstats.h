@@ -0,0 +1,26 @@
+#ifndef SCHPUNE_NESCORE_RUNSTATS_H_INCLUDED
+#define SCHPUNE_NESCORE_RUNSTATS_H_INCLUDED
+
+#include "schpunetypes.h"
+
+namespace schcore
+{
+    //////////////////////////////////////////////
+    //  Counters for profiling the emulator itself (not the emulated program).
+    //    Accumulated since the last hard reset or Nes::clearRunStats
+
+    struct RunStats
+    {
+        // Event manager
+        u64         eventWakeups = 0;           // times a predicted event came due and subsystems had to be run
+        u64         spuriousWakeups = 0;        //   ... of those, how many didn't raise an IRQ, NMI or DMA
+        u64         eventsCancelled = 0;        // predictions that were replaced or retracted before coming due
+
+        // CPU
+        u64         instructions = 0;           // instructions executed (including those in skipped idle loops)
+        u64         idleLoopSkips = 0;          // times the CPU fast-forwarded through an idle loop
+        u64         idleCyclesSkipped = 0;      //   ... and how many CPU cycles that skipped in total
+    };
+}
+
+#endif
@@ -21,7 +21,20 @@ namespace schcore
     ////////////////////////////////////////////////
     // Other common types
     typedef std::uint_fast16_t  irqsource_t;
+
+    ////////////////////////////////////////////////
+    // Timestamps
+    //    By default timestamps are 32-bit, and every subsystem gets rebased back to zero at the end of each frame
+    //  so they never overflow.  Build with SCHPUNE_MONOTONIC_TIMELINE defined to make them a 64-bit master clock
+    //  which only ever counts up from the hard reset -- nothing is rebased, and a timestamp means the same thing
+    //  no matter when you look at it.
+#ifdef SCHPUNE_MONOTONIC_TIMELINE
+    typedef std::int64_t        timestamp_t;
+    static const bool           monotonicTimeline = true;
+#else
     typedef std::int_fast32_t   timestamp_t;
+    static const bool           monotonicTimeline = false;
+#endif
 
     ////////////////////////////////////////////////
     // Special fixed timestamp values
@@ -0,0 +1,18 @@
+#ifndef SCHPUNE_NESCORE_VIDEOFORMAT_H_INCLUDED
+#define SCHPUNE_NESCORE_VIDEOFORMAT_H_INCLUDED
+
+namespace schcore
+{
+    //////////////////////////////////////////////
+    //  Pixel formats the PPU can draw in (see Nes::setVideoTarget)
+
+    enum class VideoFormat
+    {
+        Index,          // u16:  NES palette index in bits 0-5, emphasis bits in 6-8 (what getVideoBuffer gives)
+        RGBA8888,       // 4 bytes, in that order in memory.  A is always $FF
+        BGRA8888,       // 4 bytes, in that order in memory.  A is always $FF  (what a 32-bit Windows DIB wants)
+        RGB565          // u16:  R in the top 5 bits, B in the low 5
+    };
+}
+
+#endif
@@ -0,0 +1,122 @@
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <chrono>
+#include <algorithm>
+#include "schpunetypes.h"
+#include "delegate.h"
+
+//////////////////////////////////////////////////////////////
+//  Bus proc benchmark
+//
+//    Measures what one bus access through the proc lists costs with the old std::function (std::bind)
+//  procs and with Delegate.  Both go through a copy of CpuBus's proc table and its readProcs loop, with a
+//  mix of handlers like a real game has:  plain RAM, and a mapper (which, like the real ones, inherits from
+//  more than one class).  Addresses come from an LCG so the handler being called keeps changing.
+//
+//      schpune-bench-delegate [accesses]       (default 100000000)
+
+using namespace schcore;
+
+namespace
+{
+    struct Ram
+    {
+        u8              mem[0x800] = {};
+        void            onRead(u16 a, u8& v)        { v = mem[a & 0x7FF];                   }
+    };
+
+    struct Registers            { u8 regs[8] = {};     virtual ~Registers() {}     };
+    struct Banks                { u8 bank = 0;         virtual ~Banks() {}         };
+    struct Mapper : public Registers, public Banks
+    {
+        u8              prg[0x8000] = {};
+        void            onRead(u16 a, u8& v)        { v = prg[(a & 0x7FFF) ^ bank];          }
+    };
+
+    //  The same table and read loop as CpuBus, for any proc type
+    template <typename Proc>
+    struct Procs
+    {
+        static const int    maxProcs = 6;
+        Proc                readers[0x10][maxProcs];
+        u8                  dLine = 0;
+
+        u8 read(u16 a)
+        {
+            u8 v = dLine;
+            for(auto& proc : readers[a>>12])
+            {
+                if(!proc)       break;
+                proc(a, v);
+            }
+            return dLine = v;
+        }
+    };
+
+    template <typename Proc>
+    double run(Procs<Proc>& procs, long long accesses, unsigned& sum)
+    {
+        double best = 1e30;
+        for(int pass = 0; pass < 5; ++pass)
+        {
+            u32 lcg = 12345;
+            auto start = std::chrono::steady_clock::now();
+            for(long long i = 0; i < accesses; ++i)
+            {
+                lcg = lcg * 1664525 + 1013904223;
+                sum += procs.read( static_cast<u16>(lcg >> 16) );
+            }
+            double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+            best = std::min(best, ns / accesses);
+        }
+        return best;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    long long accesses = (argc > 1) ? std::atoll(argv[1]) : 100000000LL;
+    if(accesses <= 0)
+    {
+        std::fprintf(stderr, "usage: schpune-bench-delegate [accesses]\n");
+        return 1;
+    }
+
+    Ram         ram;
+    Mapper      mapper;
+    unsigned    sum = 0;
+    for(int i = 0; i < 0x800; ++i)      ram.mem[i] =    static_cast<u8>(i);
+    for(int i = 0; i < 0x8000; ++i)     mapper.prg[i] = static_cast<u8>(i >> 3);
+
+    // RAM on $0xxx-$1xxx, the mapper on $6xxx-$Fxxx (nothing in between, like open bus)
+    typedef std::function<void(u16,u8&)>    oldproc_t;
+    typedef Delegate<void(u16,u8&)>         newproc_t;
+    std::unique_ptr<Procs<oldproc_t>>       oldprocs( new Procs<oldproc_t> );
+    std::unique_ptr<Procs<newproc_t>>       newprocs( new Procs<newproc_t> );
+    using std::placeholders::_1;
+    using std::placeholders::_2;
+    for(int page = 0; page < 0x10; ++page)
+    {
+        if(page < 2)
+        {
+            oldprocs->readers[page][0] = std::bind(&Ram::onRead, &ram, _1, _2);
+            newprocs->readers[page][0] = newproc_t::bind<Ram, &Ram::onRead>(&ram);
+        }
+        else if(page >= 6)
+        {
+            oldprocs->readers[page][0] = std::bind(&Mapper::onRead, &mapper, _1, _2);
+            newprocs->readers[page][0] = newproc_t::bind<Mapper, &Mapper::onRead>(&mapper);
+        }
+    }
+
+    double before = run(*oldprocs, accesses, sum);
+    double after =  run(*newprocs, accesses, sum);
+
+    std::printf("procs\tns/access\n");
+    std::printf("std::function\t%.2f\n", before);
+    std::printf("Delegate\t%.2f\n", after);
+    std::printf("(checksum %u)\n", sum);        // so none of the reads can be optimized out
+    return 0;
+}
@@ -12,19 +12,19 @@ public:
     Display(const Display&) = delete;
     Display& operator = (const Display&) = delete;
 
+    static const int    width = schcore::Nes::videoWidth;
+    static const int    height = schcore::Nes::videoHeight;
+
     void        refresh_nsf(int track, int count);
-    void        refresh_rom(const u16* src);
+    u32*        getPixels()         { return pixels;        }   // the Nes draws straight into these (BGRA8888)
 
-    void        blit(HDC target);
+    void        blit(HDC target);       // at 2x
 
 private:
     HDC         dc;
     HBITMAP     bmp;
     HBITMAP     bmpold;
     u32*        pixels;
-    u32         palette[0x200];
-
-    void        buildPalette();
 };
 
 #endif
\ No newline at end of file
@@ -167,7 +167,6 @@ void doFrame()
     fillAudio();
     if(!isnsf)
     {
-        display.refresh_rom( nes.getVideoBuffer() );
         HDC dc = GetDC(wnd);
         display.blit(dc);
         ReleaseDC(wnd, dc);
@@ -234,6 +233,11 @@ void loadFile()
     if(loaded)
     {
         isnsf = nes.isNsf();
+
+        // ROMs draw straight into the display.  NSFs get the track display instead
+        if(isnsf)   nes.setVideoTarget( nullptr, 0, schcore::VideoFormat::Index );
+        else        nes.setVideoTarget( display.getPixels(), Display::width * 4, schcore::VideoFormat::BGRA8888 );
+
         if(isnsf)
         {
             display.refresh_nsf( nes.nsf_getTrack(), nes.nsf_getTrackCount() );
@@ -0,0 +1,1056 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+
+#ifdef _WIN32
+    #define NOMINMAX
+    #include <Windows.h>
+#else
+    #include <dirent.h>
+    #include <sys/stat.h>
+    #include <sys/types.h>
+#endif
+
+#include "nes.h"
+#include "movie.h"
+#include "ntscfilter.h"
+#include "batchrunner.h"
+#include "rewinder.h"
+
+//////////////////////////////////////////////////////////////
+//  Headless runner
+//
+//    Runs .nes/.nsf files at full speed with no video/audio output, and reports how fast they ran.  Directories
+//  are searched (recursively) for .nes/.nsf files, so "schpune-headless testfiles" runs everything.
+//
+//    Output is one tab-separated line per file (plus a header and a total line), so it's easy to feed into
+//  a script or a spreadsheet.
+//
+//    It also doubles as the regression suite:  --write-golden records a CRC of every frame's video and audio
+//  (and of the CPU trace, for nestest) to a golden file per input file, and --check-golden reruns everything
+//  and reports the first frame that no longer matches.  Files are independent, so -j runs them in parallel.
+
+namespace
+{
+    enum class GoldenMode
+    {
+        None,
+        Write,
+        Check
+    };
+
+    struct Options
+    {
+        int                         frames = 600;
+        int                         runAhead = 0;
+        int                         jobs = 1;               // 0 = one per core
+        int                         instances = 0;          // > 0 runs this many copies of each file in a BatchRunner
+        int                         rewindCheck = 0;        // > 0 steps a Rewinder back this many frames at the end and checks each one
+        int                         cloneCheck = 0;         // > 0 copies the Nes on this frame and checks that the copies keep up
+        std::string                 cloneInto;              // game loaded in the Nes that gets copyStateFrom (default: the same one)
+        bool                        chrCache = true;
+        bool                        ntsc = false;           // run every frame's video through an NtscFilter
+        bool                        videoTarget = false;    // draw into our own buffer with setVideoTarget
+        schcore::VideoFormat        videoFormat = schcore::VideoFormat::Index;
+        schcore::FrameOptions       frameOptions;
+        GoldenMode                  goldenMode = GoldenMode::None;
+        std::string                 goldenDir;
+        std::string                 recordFile;             // movie to record to
+        std::string                 replayFile;             //   ... or to play back (and check against)
+        std::vector<std::pair<int,int>>     input;          // (frame, button state) -- state holds until the next entry
+        std::vector<std::string>    files;
+    };
+
+    struct Result
+    {
+        std::string     status = "ok";
+        int             frames = 0;
+        double          seconds = 0;
+        unsigned long long  instructions = 0;
+        unsigned long long  samples = 0;
+    };
+
+    void usage()
+    {
+        std::printf(
+            "usage: schpune-headless [options] <file or directory>...\n"
+            "  -f, --frames N       run N frames of each file (default 600)\n"
+            "  -i, --input FILE     input script for controller 1 (applied to every file)\n"
+            "  -r, --run-ahead N    run N frames ahead (see Nes::setRunAhead)\n"
+            "  -j, --jobs N         run N files at once (0 = one per core, default 1)\n"
+            "      --instances N    run N copies of each file at once in a BatchRunner, with -j\n"
+            "                       threads.  Their memory use is reported on stderr, and it's an\n"
+            "                       error if they don't all make the same video and audio\n"
+            "      --no-video       don't draw any video (see FrameOptions)\n"
+            "      --no-audio       don't produce any audio\n"
+            "      --no-chr-cache   read CHR through the mapper instead of the CHR cache\n"
+            "      --ntsc           also run each frame through the NTSC filter (the time is included)\n"
+            "      --video-format F draw into a video target in format F:  index, rgba, bgra or rgb565\n"
+            "      --write-golden DIR   write a golden file for each file to DIR\n"
+            "      --check-golden DIR   compare each file against its golden file in DIR.  The frame\n"
+            "                       count and input recorded in the golden file are used.\n"
+            "      --check-rewind N run with a Rewinder, then step back N frames and check that each\n"
+            "                       state it loads is the one saved on that frame.  The sample rate is\n"
+            "                       changed partway through, so some of the history is whole states\n"
+            "      --check-clone K  on frame K, clone() the Nes and copyStateFrom it into two others (one\n"
+            "                       that never loaded anything, and one running another game), then run\n"
+            "                       all four with the same input and check that every frame's state and\n"
+            "                       video match\n"
+            "      --clone-into FILE    the other game for --check-clone (default: the same file)\n"
+            "      --record FILE    record a movie of the run (one file only)\n"
+            "      --replay FILE    play back a movie and report the first frame that doesn't\n"
+            "                       match it (one file only; runs as many frames as the movie)\n"
+            "\n"
+            "Input scripts have one '<frame> <buttons>' entry per line.  Buttons are any of\n"
+            "  A B s(elect) S(tart) U D L R, or '.' for none, and are held until the next entry.\n"
+            "  Lines starting with '#' are ignored.\n"
+            "\n"
+            "Golden files hold a CRC of each frame's video and audio.  Files with 'nestest' in their\n"
+            "  name also get a CRC of each frame's CPU trace.  If no input script is given when writing\n"
+            "  golden files, a fixed pattern that presses Start and moves right is used.\n"
+            );
+    }
+
+    ///////////////////////////////////////////
+    //  Input scripts
+    bool loadInputScript(const char* filename, std::vector<std::pair<int,int>>& out)
+    {
+        using schcore::input::Controller;
+
+        std::ifstream file(filename);
+        if(!file.good())
+            return false;
+
+        std::string line;
+        while(std::getline(file, line))
+        {
+            std::istringstream ln(line);
+            int frame;
+            std::string btns;
+            if(line.empty() || line[0] == '#' || !(ln >> frame >> btns))
+                continue;
+
+            int state = 0;
+            for(auto c : btns)
+            {
+                switch(c)
+                {
+                case 'A':   state |= Controller::Btn_A;         break;
+                case 'B':   state |= Controller::Btn_B;         break;
+                case 's':   state |= Controller::Btn_Select;    break;
+                case 'S':   state |= Controller::Btn_Start;     break;
+                case 'U':   state |= Controller::Btn_Up;        break;
+                case 'D':   state |= Controller::Btn_Down;      break;
+                case 'L':   state |= Controller::Btn_Left;      break;
+                case 'R':   state |= Controller::Btn_Right;     break;
+                }
+            }
+            out.emplace_back(frame, state);
+        }
+
+        std::stable_sort( out.begin(), out.end(), [] (const std::pair<int,int>& a, const std::pair<int,int>& b) { return a.first < b.first; } );
+        return true;
+    }
+
+    std::vector<std::pair<int,int>> defaultGoldenInput(int frames)
+    {
+        using schcore::input::Controller;
+
+        // Something that gets most games past their title screen and doing things
+        static const int pattern[] = {
+            0,
+            Controller::Btn_Start,
+            0,
+            Controller::Btn_Right | Controller::Btn_A,
+            Controller::Btn_Right | Controller::Btn_B,
+            Controller::Btn_Left | Controller::Btn_A,
+        };
+
+        std::vector<std::pair<int,int>> out;
+        for(int f = 0, i = 0; f < frames; f += 30, ++i)
+            out.emplace_back(f, pattern[i % (sizeof(pattern) / sizeof(pattern[0]))]);
+        return out;
+    }
+
+    ///////////////////////////////////////////
+    //  Golden files
+    //
+    //    Plain text, so a failing run can be diffed:
+    //
+    //      schpune-golden 1
+    //      frames <count>
+    //      trace <0/1>
+    //      input <frame> <buttons>         (any number of these)
+    //      <frame> <video crc> <audio crc> <trace crc>     (one per frame)
+
+    struct FrameCrc
+    {
+        unsigned long   video = 0;
+        unsigned long   audio = 0;
+        unsigned long   trace = 0;
+    };
+
+    struct GoldenFile
+    {
+        int                                 frames = 0;
+        bool                                trace = false;
+        std::vector<std::pair<int,int>>     input;
+        std::vector<FrameCrc>               crcs;
+    };
+
+    unsigned long crc32(const void* data, std::size_t size, unsigned long crc = 0)
+    {
+        static const auto table = [] {
+            std::vector<unsigned long> t(256);
+            for(unsigned long i = 0; i < 256; ++i)
+            {
+                unsigned long c = i;
+                for(int k = 0; k < 8; ++k)
+                    c = (c & 1) ? (0xEDB88320UL ^ (c >> 1)) : (c >> 1);
+                t[i] = c;
+            }
+            return t;
+        }();
+
+        auto p = static_cast<const unsigned char*>(data);
+        crc = ~crc & 0xFFFFFFFFUL;
+        for(std::size_t i = 0; i < size; ++i)
+            crc = table[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+        return ~crc & 0xFFFFFFFFUL;
+    }
+
+    std::string goldenFileName(const std::string& dir, const std::string& filename)
+    {
+        auto slash = filename.find_last_of("/\\");
+        return dir + "/" + (slash == std::string::npos ? filename : filename.substr(slash + 1)) + ".golden";
+    }
+
+    bool saveGolden(const std::string& filename, const GoldenFile& g)
+    {
+        std::ofstream file(filename);
+        if(!file.good())
+            return false;
+
+        file << "schpune-golden 1\n";
+        file << "frames " << g.frames << "\n";
+        file << "trace " << (g.trace ? 1 : 0) << "\n";
+        for(auto& i : g.input)
+            file << "input " << i.first << " " << i.second << "\n";
+
+        char line[64];
+        for(std::size_t i = 0; i < g.crcs.size(); ++i)
+        {
+            std::snprintf(line, sizeof(line), "%d %08lx %08lx %08lx\n", static_cast<int>(i), g.crcs[i].video, g.crcs[i].audio, g.crcs[i].trace);
+            file << line;
+        }
+        return file.good();
+    }
+
+    bool loadGolden(const std::string& filename, GoldenFile& g)
+    {
+        std::ifstream file(filename);
+        std::string line;
+        if(!std::getline(file, line) || line != "schpune-golden 1")
+            return false;
+
+        while(std::getline(file, line))
+        {
+            std::istringstream ln(line);
+            std::string key;
+            if(!(ln >> key))
+                continue;
+
+            if(key == "frames")         ln >> g.frames;
+            else if(key == "trace")     ln >> g.trace;
+            else if(key == "input")
+            {
+                std::pair<int,int> in;
+                if(ln >> in.first >> in.second)
+                    g.input.push_back(in);
+            }
+            else
+            {
+                FrameCrc c;
+                if(!(ln >> std::hex >> c.video >> c.audio >> c.trace))
+                    return false;
+                g.crcs.push_back(c);
+            }
+        }
+        return g.frames > 0 && static_cast<int>(g.crcs.size()) == g.frames;
+    }
+
+    bool makeDirectory(const std::string& dir)
+    {
+#ifdef _WIN32
+        return CreateDirectoryA(dir.c_str(), nullptr) || GetLastError() == ERROR_ALREADY_EXISTS;
+#else
+        return mkdir(dir.c_str(), 0777) == 0 || errno == EEXIST;
+#endif
+    }
+
+    ///////////////////////////////////////////
+    //  Finding files
+    bool isRunnable(const std::string& name)
+    {
+        if(name.size() < 4)
+            return false;
+
+        std::string ext = name.substr(name.size() - 4);
+        for(auto& c : ext)
+            c = static_cast<char>(std::tolower(c));
+
+        return ext == ".nes" || ext == ".nsf";
+    }
+
+    void addPath(const std::string& path, std::vector<std::string>& out, bool explicitfile)
+    {
+        std::vector<std::string>    entries;
+        bool                        isdir = false;
+
+#ifdef _WIN32
+        DWORD attr = GetFileAttributesA(path.c_str());
+        isdir = (attr != INVALID_FILE_ATTRIBUTES) && (attr & FILE_ATTRIBUTE_DIRECTORY);
+        if(isdir)
+        {
+            WIN32_FIND_DATAA fd;
+            HANDLE h = FindFirstFileA( (path + "\\*").c_str(), &fd );
+            if(h != INVALID_HANDLE_VALUE)
+            {
+                do
+                {
+                    entries.push_back(fd.cFileName);
+                } while(FindNextFileA(h, &fd));
+                FindClose(h);
+            }
+        }
+#else
+        struct stat st;
+        isdir = (stat(path.c_str(), &st) == 0) && S_ISDIR(st.st_mode);
+        if(isdir)
+        {
+            if(DIR* dir = opendir(path.c_str()))
+            {
+                while(auto ent = readdir(dir))
+                    entries.push_back(ent->d_name);
+                closedir(dir);
+            }
+        }
+#endif
+
+        if(!isdir)
+        {
+            if(explicitfile || isRunnable(path))
+                out.push_back(path);
+            return;
+        }
+
+        std::sort(entries.begin(), entries.end());
+        for(auto& i : entries)
+        {
+            if(i != "." && i != "..")
+                addPath(path + "/" + i, out, false);
+        }
+    }
+
+    ///////////////////////////////////////////
+    //  Running
+    Result runBatch(const std::string& filename, const Options& opts)
+    {
+        Result out;
+        try
+        {
+            schcore::BatchRunner                        batch(filename.c_str(), opts.jobs);
+            std::vector<schcore::input::Controller>     controllers(opts.instances);
+            std::vector<std::size_t>                    nextInput(opts.instances, 0);
+            std::vector<unsigned long>                  crcs(opts.instances, 0);        // of everything each one output
+            std::vector<std::vector<char>>              audio(opts.instances);
+
+            auto applyInput = [&] (int inst, int frame)
+            {
+                auto& next = nextInput[inst];
+                for(; next < opts.input.size() && opts.input[next].first <= frame; ++next)
+                    controllers[inst].setState(opts.input[next].second);
+            };
+
+            batch.addInstances(opts.instances);
+            for(int i = 0; i < opts.instances; ++i)
+            {
+                auto& nes = batch.getInstance(i);
+                nes.setInputDevice(0, &controllers[i]);
+                nes.setRunAhead(opts.runAhead);
+                nes.setChrCacheEnabled(opts.chrCache);
+                applyInput(i, 0);
+            }
+
+            batch.run(opts.frames, opts.frameOptions, [&] (schcore::Nes& nes, int inst, int frame)
+            {
+                // every instance gets the same input, so they should all come out the same.  If they don't,
+                //  something is shared between them that shouldn't be
+                auto& crc = crcs[inst];
+                if(opts.frameOptions.video)
+                    crc = crc32(nes.getVideoBuffer(), 256 * 240 * sizeof(schcore::u16), crc);
+                if(opts.frameOptions.audio)
+                {
+                    int siz = nes.getAvailableAudioSize();
+                    if(siz > static_cast<int>(audio[inst].size()))
+                        audio[inst].resize(siz);
+                    nes.getAudio(audio[inst].data(), siz, nullptr, 0);
+                    crc = crc32(audio[inst].data(), siz, crc);
+                }
+
+                applyInput(inst, frame + 1);
+                return true;
+            });
+
+            auto stats = batch.getStats();
+            out.frames =    static_cast<int>(stats.frames);
+            out.seconds =   stats.seconds;
+            for(int i = 0; i < opts.instances; ++i)
+                out.instructions += batch.getInstance(i).getRunStats().instructions;
+
+            std::fprintf(stderr, "%s:  %d instances on %d threads, %zu bytes each, %zu bytes of shared ROM\n",
+                filename.c_str(), opts.instances, batch.getThreadCount(), stats.instanceMemory, stats.sharedMemory);
+
+            for(int i = 1; i < opts.instances; ++i)
+            {
+                if(crcs[i] != crcs[0])
+                {
+                    out.status = "instance " + std::to_string(i) + " doesn't match instance 0";
+                    break;
+                }
+            }
+        }
+        catch(std::exception& e)
+        {
+            out.status = std::string("error: ") + e.what();
+        }
+        return out;
+    }
+
+    std::vector<schcore::u8> saveState(schcore::Nes& nes)
+    {
+        std::vector<schcore::u8> out( nes.getStateSize() );
+        out.resize( nes.saveState(out.data(), out.size()) );
+        return out;
+    }
+
+    Result runRewindCheck(const std::string& filename, const Options& opts)
+    {
+        Result out;
+        try
+        {
+            schcore::Nes                    nes;
+            schcore::input::Controller      controller;
+            std::vector<char>               audio(0x10000);
+            nes.setInputDevice(0, &controller);
+            nes.loadFile(filename.c_str());
+
+            const int   frames =    opts.frames;
+            const int   back =      std::min(opts.rewindCheck, frames - 1);
+            const int   switchAt =  frames - back / 2;          // where the sample rate changes (so the state size does too)
+            schcore::Rewinder               rewinder(nes, back + 1, ~std::size_t(0));
+            std::vector<std::vector<schcore::u8>>   states(frames);     // only the last back+1 are kept
+
+            auto before = nes.getAudioSettings();
+            auto after = before;
+            after.sampleRate = (before.sampleRate == 44100) ? 48000 : 44100;
+
+            auto script = opts.input.empty() ? defaultGoldenInput(frames) : opts.input;
+            auto input = script.begin();
+            auto start = std::chrono::steady_clock::now();
+            for(int frame = 0; frame < frames; ++frame)
+            {
+                if(frame == switchAt)
+                    nes.setAudioSettings(after);
+                for(; input != script.end() && input->first <= frame; ++input)
+                    controller.setState(input->second);
+
+                nes.doFrame();
+                int siz = nes.getAvailableAudioSize();
+                if(siz > static_cast<int>(audio.size()))
+                    audio.resize(siz);
+                nes.getAudio(audio.data(), siz, nullptr, 0);
+
+                rewinder.capture();
+                if(frame >= frames - 1 - back)
+                    states[frame] = saveState(nes);
+            }
+
+            for(int frame = frames - 2; frame >= frames - 1 - back; --frame)
+            {
+                // states from before the switch only go back in exactly with the sample rate they were made with
+                if(frame == switchAt - 1)
+                    nes.setAudioSettings(before);
+
+                if(!rewinder.stepBack())
+                {
+                    out.status = "rewind ran out at frame " + std::to_string(frame);
+                    break;
+                }
+                if(saveState(nes) != states[frame])
+                {
+                    out.status = "rewind mismatch at frame " + std::to_string(frame);
+                    break;
+                }
+            }
+            if(out.status == "ok" && rewinder.stepBack())
+                out.status = "rewind kept more than " + std::to_string(back + 1) + " frames";
+
+            out.frames =        frames;
+            out.seconds =       std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            out.instructions =  nes.getRunStats().instructions;
+        }
+        catch(std::exception& e)
+        {
+            out.status = std::string("error: ") + e.what();
+        }
+        return out;
+    }
+
+    Result runCloneCheck(const std::string& filename, const Options& opts)
+    {
+        Result out;
+        try
+        {
+            struct Copy
+            {
+                std::unique_ptr<schcore::Nes>   nes;
+                schcore::input::Controller      controller;
+                const char*                     name;
+            };
+            Copy                original, cloned, fresh, other;
+            std::vector<char>   audio(0x10000);
+
+            auto runFrame = [&](Copy& c, int state)
+            {
+                c.controller.setState(state);
+                c.nes->doFrame();
+                int siz = c.nes->getAvailableAudioSize();
+                if(siz > static_cast<int>(audio.size()))
+                    audio.resize(siz);
+                c.nes->getAudio(audio.data(), siz, nullptr, 0);
+            };
+
+            original.nes.reset( new schcore::Nes );
+            original.nes->setInputDevice(0, &original.controller);
+            original.nes->loadFile(filename.c_str());
+
+            fresh.nes.reset( new schcore::Nes );
+            fresh.nes->setInputDevice(0, &fresh.controller);
+            fresh.name = "copy into an empty Nes";
+
+            // let the other game get going first, so there's real state to throw away
+            other.nes.reset( new schcore::Nes );
+            other.nes->setInputDevice(0, &other.controller);
+            other.nes->loadFile( (opts.cloneInto.empty() ? filename : opts.cloneInto).c_str() );
+            for(int frame = 0; frame < 30; ++frame)
+                runFrame(other, 0);
+            other.name = "copy into a running Nes";
+
+            const int   frames = opts.frames;
+            auto script = opts.input.empty() ? defaultGoldenInput(frames) : opts.input;
+            auto input = script.begin();
+            int state = 0;
+            auto start = std::chrono::steady_clock::now();
+            for(int frame = 0; frame < frames; ++frame)
+            {
+                for(; input != script.end() && input->first <= frame; ++input)
+                    state = input->second;
+
+                if(frame == opts.cloneCheck)
+                {
+                    // the source is only read, so the copies can all be made at once
+                    std::thread a( [&] { fresh.nes->copyStateFrom(*original.nes); } );
+                    std::thread b( [&] { other.nes->copyStateFrom(*original.nes); } );
+                    cloned.nes = original.nes->clone();
+                    cloned.nes->setInputDevice(0, &cloned.controller);
+                    cloned.name = "clone";
+                    a.join();
+                    b.join();
+                }
+
+                runFrame(original, state);
+                if(!cloned.nes)
+                    continue;
+
+                auto wantState = saveState(*original.nes);
+                auto wantVideo = crc32(original.nes->getVideoBuffer(), 256 * 240 * sizeof(schcore::u16));
+                for(auto* c : { &cloned, &fresh, &other })
+                {
+                    runFrame(*c, state);
+                    if(saveState(*c->nes) != wantState || crc32(c->nes->getVideoBuffer(), 256 * 240 * sizeof(schcore::u16)) != wantVideo)
+                    {
+                        out.status = std::string(c->name) + " mismatch at frame " + std::to_string(frame);
+                        break;
+                    }
+                }
+                if(out.status != "ok")
+                    break;
+            }
+            if(out.status == "ok" && !cloned.nes)
+                out.status = "never got to frame " + std::to_string(opts.cloneCheck);
+
+            out.frames =        frames;
+            out.seconds =       std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            out.instructions =  original.nes->getRunStats().instructions;
+        }
+        catch(std::exception& e)
+        {
+            out.status = std::string("error: ") + e.what();
+        }
+        return out;
+    }
+
+    Result runFile(const std::string& filename, const Options& opts)
+    {
+        if(opts.instances > 0)
+            return runBatch(filename, opts);
+        if(opts.rewindCheck > 0)
+            return runRewindCheck(filename, opts);
+        if(opts.cloneCheck > 0)
+            return runCloneCheck(filename, opts);
+
+        Result                          out;
+        schcore::Nes                    nes;
+        schcore::input::Controller      controller;
+        schcore::Movie                  movie(nes, &controller);
+        std::vector<char>               audio(0x10000);
+        std::unique_ptr<schcore::NtscFilter>    ntsc;
+        std::vector<schcore::u32>       ntscOut;
+        std::vector<schcore::u32>       target;
+
+        nes.setInputDevice(0, &controller);
+        if(opts.videoTarget)
+        {
+            bool wide = (opts.videoFormat == schcore::VideoFormat::RGBA8888 || opts.videoFormat == schcore::VideoFormat::BGRA8888);
+            target.resize( schcore::Nes::videoWidth * schcore::Nes::videoHeight );
+            nes.setVideoTarget( target.data(), schcore::Nes::videoWidth * (wide ? 4 : 2), opts.videoFormat );
+        }
+        nes.setRunAhead(opts.runAhead);
+        nes.setChrCacheEnabled(opts.chrCache);
+        try
+        {
+            nes.loadFile(filename.c_str());
+        }
+        catch(std::exception& e)
+        {
+            out.status = std::string("error: ") + e.what();
+            return out;
+        }
+
+        int frames = opts.frames;
+        bool useMovie = !opts.recordFile.empty() || !opts.replayFile.empty();
+        bool useGolden = opts.goldenMode != GoldenMode::None;
+        GoldenFile golden;
+        std::string goldenName = goldenFileName(opts.goldenDir, filename);
+        std::ostringstream trace;
+
+        if(opts.goldenMode == GoldenMode::Check)
+        {
+            if(!loadGolden(goldenName, golden))
+            {
+                out.status = "error: unable to read golden file";
+                return out;
+            }
+            frames = golden.frames;
+        }
+        else if(opts.goldenMode == GoldenMode::Write)
+        {
+            golden.frames = frames;
+            golden.trace =  filename.find("nestest") != std::string::npos;
+            golden.input =  opts.input.empty() ? defaultGoldenInput(frames) : opts.input;
+        }
+        if(golden.trace)
+            nes.setTracer(&trace);
+
+        if(!opts.replayFile.empty())
+        {
+            std::ifstream file(opts.replayFile, std::ios::binary);
+            try
+            {
+                if(!file.good())    throw std::runtime_error("unable to open movie");
+                movie.load(file);
+            }
+            catch(std::exception& e)
+            {
+                out.status = std::string("error: ") + e.what();
+                return out;
+            }
+            frames = movie.getFrameCount();
+            movie.startPlayback();
+        }
+        else if(!opts.recordFile.empty())
+            movie.startRecording();
+
+        if(opts.ntsc && opts.frameOptions.video)
+        {
+            ntsc.reset(new schcore::NtscFilter(schcore::VideoFormat::BGRA8888));
+            ntscOut.resize(ntsc->getWidth() * schcore::Nes::videoHeight);
+        }
+        auto filterVideo = [&] (int frame)
+        {
+            if(ntsc)
+                ntsc->filter(nes.getVideoBuffer(), schcore::Nes::videoWidth * sizeof(schcore::u16),
+                             ntscOut.data(), ntsc->getWidth() * sizeof(schcore::u32), frame & 1);
+        };
+
+        const int bytesPerSample = nes.getAudioSettings().stereo ? 4 : 2;
+        auto& script = useGolden ? golden.input : opts.input;
+        auto input = script.begin();
+        nes.clearRunStats();
+
+        auto start = std::chrono::steady_clock::now();
+        for(int frame = 0; frame < frames; ++frame)
+        {
+            if(useMovie)
+            {
+                if(movie.isRecording())
+                {
+                    for(; input != opts.input.end() && input->first <= frame; ++input)
+                        controller.setState(input->second);
+                }
+                movie.doFrame();
+                filterVideo(frame);
+
+                int siz = movie.getAvailableAudioSize();
+                if(siz > static_cast<int>(audio.size()))
+                    audio.resize(siz);
+                out.samples += movie.getAudio(audio.data(), siz, nullptr, 0) / bytesPerSample;
+                continue;
+            }
+
+            for(; input != script.end() && input->first <= frame; ++input)
+                controller.setState(input->second);
+
+            nes.doFrame(opts.frameOptions);
+            filterVideo(frame);
+
+            int siz = nes.getAvailableAudioSize();
+            if(siz > static_cast<int>(audio.size()))
+                audio.resize(siz);
+            siz = nes.getAudio(audio.data(), siz, nullptr, 0);
+            out.samples += siz / bytesPerSample;
+
+            if(useGolden)
+            {
+                FrameCrc crc;
+                crc.video = crc32(nes.getVideoBuffer(), 256 * 240 * sizeof(schcore::u16));
+                crc.audio = crc32(audio.data(), siz);
+                if(golden.trace)
+                {
+                    auto str = trace.str();
+                    crc.trace = crc32(str.data(), str.size());
+                    trace.str("");
+                }
+
+                if(opts.goldenMode == GoldenMode::Write)
+                    golden.crcs.push_back(crc);
+                else
+                {
+                    auto& g = golden.crcs[frame];
+                    const char* what =  g.video != crc.video ? "video" :
+                                        g.audio != crc.audio ? "audio" :
+                                        g.trace != crc.trace ? "trace" : nullptr;
+                    if(what)
+                    {
+                        out.status = std::string(what) + " mismatch at frame " + std::to_string(frame);
+                        frames = frame + 1;
+                        break;
+                    }
+                }
+            }
+        }
+        auto stop = std::chrono::steady_clock::now();
+
+        if(movie.isRecording())
+        {
+            std::ofstream file(opts.recordFile, std::ios::binary);
+            movie.save(file);
+            if(!file.good())
+                out.status = "error: unable to write movie";
+        }
+        else if(movie.getDesyncFrame() >= 0)
+            out.status = "desync at frame " + std::to_string(movie.getDesyncFrame());
+        else if(opts.goldenMode == GoldenMode::Write && !saveGolden(goldenName, golden))
+            out.status = "error: unable to write golden file";
+
+        out.frames =        frames;
+        out.seconds =       std::chrono::duration<double>(stop - start).count();
+        out.instructions =  nes.getRunStats().instructions;
+        return out;
+    }
+
+    void printResult(const std::string& name, const Result& r)
+    {
+        double fps = r.seconds > 0 ? r.frames / r.seconds        : 0;
+        double ips = r.seconds > 0 ? r.instructions / r.seconds  : 0;
+
+        std::printf("%s\t%s\t%d\t%.4f\t%.1f\t%llu\t%.0f\t%llu\n",
+            name.c_str(), r.status.c_str(), r.frames, r.seconds, fps, r.instructions, ips, r.samples);
+        std::fflush(stdout);
+    }
+
+    ///////////////////////////////////////////
+    //  Running several files at once
+    //    Each file gets its own Nes, so they can just be handed out to worker threads.  Results are still
+    //  reported in order, as soon as every file before them is done.
+    template <typename Report>
+    void runAll(const Options& opts, int jobs, Report report)
+    {
+        const std::size_t           count = opts.files.size();
+        std::vector<Result>         results(count);
+        std::vector<bool>           done(count, false);
+        std::atomic<std::size_t>    next(0);
+        std::mutex                  lock;
+        std::condition_variable     cv;
+
+        auto worker = [&]
+        {
+            for(std::size_t i; (i = next++) < count; )
+            {
+                Result r = runFile(opts.files[i], opts);
+
+                std::lock_guard<std::mutex> lk(lock);
+                results[i] = std::move(r);
+                done[i] = true;
+                cv.notify_one();
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for(int i = 0; i < jobs; ++i)
+            threads.emplace_back(worker);
+
+        for(std::size_t i = 0; i < count; ++i)
+        {
+            std::unique_lock<std::mutex> lk(lock);
+            cv.wait(lk, [&] { return done[i]; });
+            lk.unlock();
+            report(opts.files[i], results[i]);
+        }
+
+        for(auto& t : threads)
+            t.join();
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Options         opts;
+
+    for(int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool hasval = (i + 1 < argc);
+
+        if(arg == "-h" || arg == "--help")
+        {
+            usage();
+            return 0;
+        }
+        else if((arg == "-f" || arg == "--frames") && hasval)
+        {
+            opts.frames = std::atoi(argv[++i]);
+        }
+        else if((arg == "-r" || arg == "--run-ahead") && hasval)
+        {
+            opts.runAhead = std::atoi(argv[++i]);
+        }
+        else if((arg == "-j" || arg == "--jobs") && hasval)
+        {
+            opts.jobs = std::atoi(argv[++i]);
+        }
+        else if(arg == "--instances" && hasval)
+        {
+            opts.instances = std::atoi(argv[++i]);
+        }
+        else if(arg == "--no-video")
+        {
+            opts.frameOptions.video = false;
+        }
+        else if(arg == "--no-audio")
+        {
+            opts.frameOptions.audio = false;
+        }
+        else if(arg == "--no-chr-cache")
+        {
+            opts.chrCache = false;
+        }
+        else if(arg == "--ntsc")
+        {
+            opts.ntsc = true;
+        }
+        else if(arg == "--video-format" && hasval)
+        {
+            std::string f = argv[++i];
+            opts.videoTarget = true;
+            if(f == "index")            opts.videoFormat = schcore::VideoFormat::Index;
+            else if(f == "rgba")        opts.videoFormat = schcore::VideoFormat::RGBA8888;
+            else if(f == "bgra")        opts.videoFormat = schcore::VideoFormat::BGRA8888;
+            else if(f == "rgb565")      opts.videoFormat = schcore::VideoFormat::RGB565;
+            else
+            {
+                std::fprintf(stderr, "Unknown video format '%s'\n", f.c_str());
+                return 1;
+            }
+        }
+        else if(arg == "--write-golden" && hasval)
+        {
+            opts.goldenMode = GoldenMode::Write;
+            opts.goldenDir = argv[++i];
+        }
+        else if(arg == "--check-golden" && hasval)
+        {
+            opts.goldenMode = GoldenMode::Check;
+            opts.goldenDir = argv[++i];
+        }
+        else if(arg == "--check-rewind" && hasval)
+        {
+            opts.rewindCheck = std::atoi(argv[++i]);
+        }
+        else if(arg == "--check-clone" && hasval)
+        {
+            opts.cloneCheck = std::atoi(argv[++i]);
+        }
+        else if(arg == "--clone-into" && hasval)
+        {
+            opts.cloneInto = argv[++i];
+        }
+        else if(arg == "--record" && hasval)
+        {
+            opts.recordFile = argv[++i];
+        }
+        else if(arg == "--replay" && hasval)
+        {
+            opts.replayFile = argv[++i];
+        }
+        else if((arg == "-i" || arg == "--input") && hasval)
+        {
+            if(!loadInputScript(argv[++i], opts.input))
+            {
+                std::fprintf(stderr, "Unable to open input script '%s'\n", argv[i]);
+                return 1;
+            }
+        }
+        else if(!arg.empty() && arg[0] == '-')
+        {
+            std::fprintf(stderr, "Unknown option '%s'\n", arg.c_str());
+            usage();
+            return 1;
+        }
+        else
+            addPath(arg, opts.files, true);
+    }
+
+    if(opts.files.empty())
+    {
+        usage();
+        return 1;
+    }
+    if((!opts.recordFile.empty() || !opts.replayFile.empty()) && opts.files.size() != 1)
+    {
+        std::fprintf(stderr, "Movies can only be recorded or played back with a single file\n");
+        return 1;
+    }
+    if((!opts.frameOptions.video || !opts.frameOptions.audio) &&
+       (opts.goldenMode != GoldenMode::None || !opts.recordFile.empty() || !opts.replayFile.empty()))
+    {
+        std::fprintf(stderr, "--no-video and --no-audio can't be used with golden files or movies\n");
+        return 1;
+    }
+    if(opts.instances > 0 && (opts.goldenMode != GoldenMode::None || !opts.recordFile.empty() || !opts.replayFile.empty() || opts.ntsc))
+    {
+        std::fprintf(stderr, "--instances can't be used with golden files, movies or --ntsc\n");
+        return 1;
+    }
+    if(opts.rewindCheck > 0 && (opts.goldenMode != GoldenMode::None || !opts.recordFile.empty() || !opts.replayFile.empty() ||
+                                opts.instances > 0 || opts.ntsc || opts.videoTarget))
+    {
+        std::fprintf(stderr, "--check-rewind can't be used with golden files, movies, --instances, --ntsc or --video-format\n");
+        return 1;
+    }
+    if(opts.cloneCheck > 0 && (opts.goldenMode != GoldenMode::None || !opts.recordFile.empty() || !opts.replayFile.empty() ||
+                               opts.instances > 0 || opts.ntsc || opts.videoTarget || opts.rewindCheck > 0))
+    {
+        std::fprintf(stderr, "--check-clone can't be used with golden files, movies, --instances, --ntsc, --video-format or --check-rewind\n");
+        return 1;
+    }
+    if(!opts.cloneInto.empty() && opts.cloneCheck <= 0)
+    {
+        std::fprintf(stderr, "--clone-into only goes with --check-clone\n");
+        return 1;
+    }
+    if(opts.videoTarget && (opts.goldenMode != GoldenMode::None || opts.instances > 0 || opts.ntsc))
+    {
+        std::fprintf(stderr, "--video-format can't be used with golden files, --instances or --ntsc\n");
+        return 1;
+    }
+    if(opts.goldenMode != GoldenMode::None)
+    {
+        if(!opts.recordFile.empty() || !opts.replayFile.empty())
+        {
+            std::fprintf(stderr, "Golden files can't be used along with movies\n");
+            return 1;
+        }
+
+        std::vector<std::string> names;
+        for(auto& f : opts.files)
+            names.push_back(goldenFileName(opts.goldenDir, f));
+        std::sort(names.begin(), names.end());
+        auto dup = std::adjacent_find(names.begin(), names.end());
+        if(dup != names.end())
+        {
+            std::fprintf(stderr, "More than one file would use the golden file '%s'\n", dup->c_str());
+            return 1;
+        }
+
+        if(opts.goldenMode == GoldenMode::Write && !makeDirectory(opts.goldenDir))
+        {
+            std::fprintf(stderr, "Unable to create directory '%s'\n", opts.goldenDir.c_str());
+            return 1;
+        }
+    }
+
+    int jobs = opts.jobs;
+    if(jobs <= 0)
+        jobs = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    jobs = std::min(jobs, static_cast<int>(opts.files.size()));
+    if(opts.instances > 0)
+        jobs = 1;               // the batch runner does the threading
+
+    ////////////////////////////////
+    std::printf("file\tstatus\tframes\tseconds\tfps\tinstructions\tips\tsamples\n");
+
+    Result  total;
+    int     failures = 0;
+    runAll(opts, jobs, [&] (const std::string& f, const Result& r)
+    {
+        printResult(f, r);
+
+        if(r.status != "ok")
+            ++failures;
+        total.frames +=         r.frames;
+        total.seconds +=        r.seconds;
+        total.instructions +=   r.instructions;
+        total.samples +=        r.samples;
+    });
+
+    if(failures)
+        total.status = std::to_string(failures) + " failed";
+    printResult("TOTAL", total);
+
+    return failures ? 1 : 0;
+}
@@ -87,6 +87,16 @@ namespace schcore
             i->endFrame(sub);
     }
 
+    void Apu::setAudioEnabled(bool on)
+    {
+        // The audio side sat still while audio was off, so it could be partway through a DMC clip that
+        //   ended long ago.  Nothing else on the audio side matters (it's just waveform positions).
+        if(on && !audioEnabled)
+            tnd.resyncAudio();
+
+        audioEnabled = on;
+    }
+
     void Apu::silenceAllChannels()
     {
         pulses.makeSilent();
@@ -96,6 +106,14 @@ namespace schcore
             i.second->makeSilent();
     }
 
+    std::size_t Apu::getMemoryUsage() const
+    {
+        std::size_t out = pulses.getMemoryUsage() + tnd.getMemoryUsage();
+        for(auto& i : exAudioChannels)
+            out += i.second->getMemoryUsage();
+        return out;
+    }
+
     void Apu::addExAudioChannel(ChannelId id, AudioChannel* chan, bool apply_clock_rate)
     {
         if(apply_clock_rate)
@@ -234,7 +252,8 @@ namespace schcore
             // advance our aud/cpu timestamps
             ticks -= step;
             cyc(step);
-            audTimestamp = std::min( audTimestamp + (step * getClockBase()),  builder->getMaxAllowedTimestamp() );
+            if(audioEnabled)
+                audTimestamp = std::min( audTimestamp + (step * getClockBase()),  builder->getMaxAllowedTimestamp() );
 
             // run all channels up to this point
             pulses.run(curCyc(), audTimestamp);
@@ -311,11 +330,12 @@ namespace schcore
             exAudioMasters.clear();
 
             eventManager = info.eventManager;
+            frameIrqEvent = eventManager->createHandle(EventType::evt_apu);
 
             // capture the bus
             bus = info.cpuBus;
-            bus->addReader(0x4,0x4,this,&Apu::onRead);
-            bus->addWriter(0x4,0x4,this,&Apu::onWrite);
+            bus->addReader<Apu, &Apu::onRead>(0x4,0x4,this);
+            bus->addWriter<Apu, &Apu::onWrite>(0x4,0x4,this);
             frameIrqBit = bus->createIrqCode("APU Frame");
 
             // capture the builder
@@ -351,13 +371,36 @@ namespace schcore
         predictNextEvent();
     }
 
+    void Apu::serialize(StateStream& s)
+    {
+        subSystem_Serialize(s);
+
+        s(oddCycle);
+        s.time(seqCounter);
+        s(nextSeqPhase);
+        s(seqMode);
+        s.time(modeResetCounter);
+        s(newSeqMode);
+        s(frameIrqEnabled);
+        s(frameIrqPending);
+        s.time(audTimestamp);
+
+        pulses.serialize(s);
+        tnd.serialize(s);
+    }
+
     ///////////////////////////////////////////////////
     //  IRQ prediction
 
     void Apu::predictNextEvent()
     {
-        if(frameIrqPending)     return;     // if IRQ is already pending, no need to check for next one
-        if(!frameIrqEnabled)    return;     // if IRQs aren't enabled, no need to check for them
+        eventManager->setEvent( frameIrqEvent, predictFrameIrq() );
+    }
+
+    timestamp_t Apu::predictFrameIrq()
+    {
+        if(frameIrqPending)     return Time::Never;     // if IRQ is already pending, no need to check for next one
+        if(!frameIrqEnabled)    return Time::Never;     // if IRQs aren't enabled, no need to check for them
         
         // The 'delay' counter after writing to $4017 complicates this a bit, because we
         //   have to check the current mode, then we have to check the mode we switch to
@@ -376,13 +419,11 @@ namespace schcore
             if(!seqMode && (seqCounter <= modeResetCounter) && (FrSeqPhases[0][nextSeqPhase] & FrSeq_Irq))
             {
                 // it'll happen in 'seqCounter' ticks!
-                ticks = (seqCounter * getClockBase()) + curCyc();
-                eventManager->addEvent(ticks, EventType::evt_apu);
-                return;
+                return (seqCounter * getClockBase()) + curCyc();
             }
 
             // otherwise, it won't happen before the reset.  Switch the mode we're checking to the new mode
-            if(newSeqMode & 0x80)       return;     // won't happen in 5-step mode
+            if(newSeqMode & 0x80)       return Time::Never;     // won't happen in 5-step mode
 
             ticks = modeResetCounter;
             cntr = FrSeqTimes[0][0];
@@ -405,7 +446,7 @@ namespace schcore
         ticks *= getClockBase();
         ticks += curCyc();
 
-        eventManager->addEvent(ticks, EventType::evt_apu);
+        return ticks;
     }
 
 }
\ No newline at end of file
@@ -8,6 +8,7 @@
 #include "apu_tnd.h"
 #include "audiotimestampholder.h"
 #include "audiosettings.h"
+#include "eventmanager.h"
 #include <map>
 
 
@@ -27,6 +28,7 @@ namespace schcore
         //////////////////////////////////////////////////
         //  Resetting
         void                reset(const ResetInfo& info);
+        void                serialize(StateStream& s);      // expansion audio is serialized by whoever owns it
         
         //////////////////////////////////////////////////
         //  Expansion audio
@@ -39,11 +41,14 @@ namespace schcore
         void                setAudioSettings(const AudioSettings& settings);
 
         void                silenceAllChannels();
+        std::size_t         getMemoryUsage() const;             // output level tables, expansion channels included
 
         //////////////////////////////////////////////////
         //  Running
         virtual void        run(timestamp_t runto) override;
         void                fabricateMoreAudio(int bytes);
+        void                setAudioEnabled(bool on);           // when off, channels only do their CPU-visible work
+        bool                isAudioEnabled() const                                  { return audioEnabled;      }
 
         
         virtual void        subtractFromAudioTimestamp(timestamp_t sub) override    { audTimestamp -= sub;      }
@@ -57,6 +62,7 @@ namespace schcore
 
         timestamp_t         calcTicksToRun( timestamp_t now, timestamp_t target ) const;
         void                predictNextEvent();
+        timestamp_t         predictFrameIrq();
         
         void                onWrite(u16 a, u8 v);
         void                onRead(u16 a, u8& v);
@@ -67,6 +73,7 @@ namespace schcore
         CpuBus*             bus;
         AudioBuilder*       builder;
         EventManager*       eventManager;
+        EventManager::handle_t  frameIrqEvent;
 
         bool                oddCycle;
         timestamp_t         seqCounter;
@@ -81,6 +88,7 @@ namespace schcore
         irqsource_t         frameIrqBit;
 
         timestamp_t         audTimestamp;
+        bool                audioEnabled = true;
 
 
         Apu_Pulse           pulses;
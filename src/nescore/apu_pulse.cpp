@@ -86,11 +86,25 @@ namespace schcore
         timestamp_t next = Time::Never;
 
         if(dat[0].isAudible())      next = dat[0].freqCounter;
-        if(dat[1].isAudible())      next = std::min(next, dat[1].freqCounter);
+        if(dat[1].isAudible())      next = std::min<timestamp_t>(next, dat[1].freqCounter);
 
         return next;
     }
 
+    void Apu_Pulse::serialize(StateStream& s)
+    {
+        channelSerialize(s);
+        for(auto& d : dat)
+        {
+            d.length.serialize(s);
+            d.decay.serialize(s);
+            d.sweep.serialize(s);
+            s(d.freqCounter);
+            s(d.dutyPhase);
+            s(d.dutyMode);
+        }
+    }
+
     void Apu_Pulse::reset(bool hard)
     {
         if(hard)
@@ -22,6 +22,7 @@ namespace schcore
         void                    read4015(u8& v);
 
         void                    reset(bool hard);
+        void                    serialize(StateStream& s);
         void                    clockSeqHalf();
         void                    clockSeqQuarter();
         
@@ -3,6 +3,7 @@
 #define SCHPUNE_NESCORE_APUSUPPORT_H_INCLUDED
 
 #include "schpunetypes.h"
+#include "statestream.h"
 
 
 
@@ -25,6 +26,7 @@ namespace schcore
         bool                isAudible() const   { return counter != 0;                              }
 
         void                hardReset()         { counter = 0; halted = enabled = false;            }
+        void                serialize(StateStream& s)   { s(counter);  s(halted);  s(enabled);             }
 
     private:
         static const u8     loadTable[0x20];
@@ -44,6 +46,7 @@ namespace schcore
         bool                isAudible() const   { return counter != 0;                              }
 
         void                hardReset()         { load = counter = 0; control = reload = false;     }
+        void                serialize(StateStream& s)   { s(load);  s(counter);  s(control);  s(reload);   }
         
         void                clock()
         {
@@ -83,6 +86,12 @@ namespace schcore
             constVol = true;
             reload = false;
         }
+
+        void                serialize(StateStream& s)
+        {
+            s(timer);   s(counter);     s(volume);
+            s(loop);    s(constVol);    s(reload);
+        }
         
         void                clock()
         {
@@ -174,6 +183,12 @@ namespace schcore
             counter = 0xF;
         }
 
+        void serialize(StateStream& s)
+        {
+            s(freqReg);     s(forceSilence);    s(negate);      s(enabled);
+            s(reload);      s(subOne);          s(shift);       s(timer);       s(counter);
+        }
+
     private:
         u16         freqReg;
         bool        forceSilence;
@@ -28,6 +28,20 @@ namespace schcore
         dmcpu.len = dmcaud.len = 0;
     }
 
+    void Apu_Tnd::resyncAudio()
+    {
+        auto supplier = dmcaud.supplier;
+        dmcaud = dmcpu;
+        dmcaud.supplier = supplier;
+
+        // flush whatever was peeked, and peek the byte the DMA unit is holding instead (if any)
+        u8 t;
+        bool b;
+        dmcaud.supplier->getFetchedByte(t,b);
+        if(dmcpu.supplier->willBeAudible())
+            dmcaud.supplier->triggerFetch( static_cast<u16>((dmcpu.addr - 1) | 0x8000) );
+    }
+
     void Apu_Tnd::writeMain(u16 a, u8 v)
     {
         switch(a)
@@ -169,6 +183,42 @@ namespace schcore
         if(dmcIrqPending)           v |= 0x80;
     }
 
+    void Apu_Tnd::serialize(StateStream& s)
+    {
+        channelSerialize(s);
+
+        tri.length.serialize(s);
+        tri.linear.serialize(s);
+        s(tri.freqTimer);
+        s(tri.freqCounter);
+        s(tri.triStep);
+
+        nse.length.serialize(s);
+        nse.decay.serialize(s);
+        s(nse.freqTimer);
+        s(nse.freqCounter);
+        s(nse.shifter);
+        s(nse.shiftMode);
+
+        dmcPeekSampleBuffer.serialize(s);
+        s(dmcOut);
+        s(dmcFreqTimer);
+        s(dmcAddrLoad);
+        s(dmcLenLoad);
+        s(dmcIrqPending);
+        s(dmcIrqEnabled);
+        s(dmcLoop);
+        for(auto d : { &dmcpu, &dmcaud })
+        {
+            s(d->freqCounter);
+            s(d->len);
+            s(d->addr);
+            s(d->outputUnit);
+            s(d->bitsRemaining);
+            s(d->audible);
+        }
+    }
+
     void Apu_Tnd::reset(const ResetInfo& info)
     {
         if(info.hardReset)
@@ -184,13 +234,14 @@ namespace schcore
 
             nse.decay.hardReset();
             nse.length.hardReset();
-            nse.freqTimer = nse.freqTimer = noiseFreqLut[region][0x0F];
+            nse.freqCounter = nse.freqTimer = noiseFreqLut[region][0x0F];
             nse.shiftMode = 14;
             nse.shifter = 1;
 
             dmcPeekSampleBuffer.reset(info);
             cpuBus              = info.cpuBus;
             eventManager        = info.eventManager;
+            dmcEvent            = eventManager->createHandle(EventType::evt_apu);
             apuHost             = info.apu;
             dmcOut              = 0;
             dmcFreqTimer        = dmcFreqLut[region][0];
@@ -240,9 +291,9 @@ namespace schcore
     {
         timestamp_t out = Time::Never;
         
-        if(tri.length.isAudible() && tri.linear.isAudible())        out = std::min( out, tri.freqCounter );
-        if(nse.length.isAudible() && nse.decay.getOutput())         out = std::min( out, nse.freqCounter );
-        if(dmcaud.audible || dmcPeekSampleBuffer.willBeAudible())   out = std::min( out, dmcaud.freqCounter );
+        if(tri.length.isAudible() && tri.linear.isAudible())        out = std::min<timestamp_t>( out, tri.freqCounter );
+        if(nse.length.isAudible() && nse.decay.getOutput())         out = std::min<timestamp_t>( out, nse.freqCounter );
+        if(dmcaud.audible || dmcPeekSampleBuffer.willBeAudible())   out = std::min<timestamp_t>( out, dmcaud.freqCounter );
 
         return out;
     }
@@ -326,7 +377,11 @@ namespace schcore
 
 
         //  cycle stealing will happen only if the dmcpu has a nonzero length
-        if(!dmcpu.len)      return;
+        if(!dmcpu.len)
+        {
+            eventManager->cancelEvent( dmcEvent );
+            return;
+        }
 
         // next stolen cycle will happen when all remaining bits get shifted out
         timestamp_t ticks = dmcpu.freqCounter;
@@ -337,7 +392,7 @@ namespace schcore
         ticks *= apuHost->getClockBase();
         ticks += apuHost->curCyc();
 
-        eventManager->addEvent( ticks, EventType::evt_apu );
+        eventManager->setEvent( dmcEvent, ticks );
     }
 
     
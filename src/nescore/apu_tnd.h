@@ -6,6 +6,7 @@
 #include "apu_support.h"
 #include "audiochannel.h"
 #include "dmc_supplier.h"
+#include "eventmanager.h"
 
 
 namespace schcore
@@ -26,10 +27,12 @@ namespace schcore
         void                    read4015(u8& v);
 
         void                    reset(const ResetInfo& info);
+        void                    serialize(StateStream& s);
         void                    clockSeqHalf();
         void                    clockSeqQuarter();
         
         virtual void            makeSilent() override;
+        void                    resyncAudio();          // snap the audible DMC to where the DMCPU is (after audio has been off)
 
     protected:
         virtual int             doTicks(timestamp_t ticks, bool doaudio, bool docpu) override;
@@ -69,6 +72,7 @@ namespace schcore
         Dmc_PeekSampleBuffer    dmcPeekSampleBuffer;
         CpuBus*                 cpuBus;
         EventManager*           eventManager;
+        EventManager::handle_t  dmcEvent;
         Apu*                    apuHost;
         int                     region = 0;
         u8                      dmcOut;
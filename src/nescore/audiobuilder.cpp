@@ -1,7 +1,9 @@
 
 #include <algorithm>
+#include <cmath>
 #include "audiobuilder.h"
 #include "audiotimestampholder.h"
+#include "statestream.h"
 
 namespace schcore
 {
@@ -27,6 +29,7 @@ namespace schcore
         timeScalar = 0;
         timeOverflow = 0;
         timeShift = 0;
+        timeBase = 0;
 
         outSample[0] = outSample[1] = 0;
     }
@@ -36,9 +39,43 @@ namespace schcore
     {
         setClockRates(clocks_per_second, clocks_per_frame);
         audioTimestampHolders.clear();
+        timeBase = 0;
         flushTransitionBuffers();
     }
 
+    ////////////////////////////////////////////////////
+    //  Save states
+    //    This includes the audio that has been built but not yet pulled out with generateSamples, so audio
+    //  picks up seamlessly after a load.  If the output format has changed since the state was saved, the
+    //  buffered audio can't be used and is dropped instead.
+    void AudioBuilder::serialize(StateStream& s)
+    {
+        s.time(timeBase);
+        s.time(timeOverflow);
+        s(outSample);
+        for(int i = 0; i < 2; ++i)
+        {
+            lp[i].serialize(s);
+            hp1[i].serialize(s);
+            hp2[i].serialize(s);
+        }
+
+        s32 chans = stereo ? 2 : 1;
+        s32 elements = static_cast<s32>(bufferSizeInElements);
+        s(chans);
+        s(elements);
+
+        if(s.isLoading() && (chans != (stereo ? 2 : 1) || elements != bufferSizeInElements))
+        {
+            s.skip( sizeof(float) * chans * elements );
+            flushTransitionBuffers();
+            return;
+        }
+
+        for(int i = 0; i < chans; ++i)
+            s.bytes( transitionBuffer[i].data(), sizeof(float) * elements );
+    }
+
     ////////////////////////////////////////////////////
     //  Generate audio samples!!!
 
@@ -104,10 +141,11 @@ namespace schcore
 
         ///////////////////////////////////////
         //  we need to adjust timeOverflow to account for the wiped samples,
-        //    and we need to adjust all channels audio timestamps to rebase them
+        //    and we need to adjust all channels audio timestamps to rebase them (or, if timestamps are
+        //    monotonic, just move our own base forward instead)
 
         // cut however many samples we just wiped
-        timeOverflow -= (count << (timeShift+5));
+        timeOverflow -= (static_cast<timestamp_t>(count) << (timeShift+5));
 
         // if overflow is less than 0 (likely at this point), change it to be >= 0 so our
         //   max timestamp is relevant
@@ -117,8 +155,13 @@ namespace schcore
             flip += timeScalar - 1;         // round up
             flip /= timeScalar;
 
-            for(auto& tsh : audioTimestampHolders)
-                tsh->subtractFromAudioTimestamp( flip );
+            if(monotonicTimeline)
+                timeBase += flip;
+            else
+            {
+                for(auto& tsh : audioTimestampHolders)
+                    tsh->subtractFromAudioTimestamp( flip );
+            }
 
             timeOverflow += (flip * timeScalar);
         }
@@ -126,7 +169,7 @@ namespace schcore
     
     int AudioBuilder::audioAvailableAtTimestamp( timestamp_t time )
     {
-        auto x = ((time * timeScalar) + timeOverflow) >> (timeShift + 5);
+        auto x = (((time - timeBase) * timeScalar) + timeOverflow) >> (timeShift + 5);
 
         --x;
         x *= (stereo ? 4 : 2);      // convert to bytes
@@ -139,7 +182,7 @@ namespace schcore
         timestamp_t samps = bytes / (stereo ? 4 : 2);       // bytes->samples
         ++samps;
 
-        return std::min( getMaxAllowedTimestamp(), ((samps << (timeShift + 5)) - timeOverflow) / timeScalar );
+        return std::min( getMaxAllowedTimestamp(), timeBase + ((samps << (timeShift + 5)) - timeOverflow) / timeScalar );
     }
     
     ////////////////////////////////////////////////////////
@@ -189,7 +232,9 @@ namespace schcore
             return;
         }
 
-        static constexpr timestamp_t stopvalue = (Time::Never >> 2);
+        // Keep the fixed point math in 32-bit range even when timestamps are 64-bit, so the audio comes out the
+        //   same either way (and so the shifts below stay in range)
+        static constexpr timestamp_t stopvalue = ((std::numeric_limits<s32>::max() - 10000) >> 2);
 
         // get as many bits of fraction as possible
         timeOverflow    = 0;
@@ -284,7 +329,7 @@ namespace schcore
     void AudioBuilder::addTransition( timestamp_t clocktime, float l, float r )
     {
         // Convert the given clock time to a sample time
-        timestamp_t sampletime = ((clocktime * timeScalar) + timeOverflow) >> timeShift;
+        timestamp_t sampletime = (((clocktime - timeBase) * timeScalar) + timeOverflow) >> timeShift;
         const float* set = sincTable[sampletime & 0x1F];
         sampletime >>= 5;
 
@@ -331,6 +376,7 @@ namespace schcore
     {
         k = 1.0f - std::pow( base, 48000.0f / samplerate );
     }
+    void AudioBuilder::LowPassFilter::serialize(StateStream& s)    { s(prev_out);                  }
     inline float AudioBuilder::LowPassFilter::samp(float in)
     {
         return prev_out = prev_out + ((in - prev_out) * k);
@@ -342,6 +388,7 @@ namespace schcore
     {
         k = 1.0f - (base * 48000 / samplerate);
     }
+    void AudioBuilder::HighPassFilter::serialize(StateStream& s)   { s(prev_in);   s(prev_out);    }
     inline float AudioBuilder::HighPassFilter::samp(float in)
     {
         prev_out = (prev_out * k) + in - prev_in;
@@ -10,6 +10,7 @@ namespace schcore
 {
     class AudioTimestampHolder;
     class Apu;
+    class StateStream;
 
     class AudioBuilder
     {
@@ -17,6 +18,7 @@ namespace schcore
                                 AudioBuilder();
 
         void                    hardReset( timestamp_t clocks_per_second, timestamp_t clocks_per_frame );
+        void                    serialize( StateStream& s );
 
         void                    addTransition( timestamp_t clocktime, float l, float r );
         int                     generateSamples( int startbytepos, s16* audio, int sizeinbytes );
@@ -27,9 +29,11 @@ namespace schcore
 
         void                    setClockRates( timestamp_t clocks_per_second, timestamp_t clocks_per_frame );
 
-        timestamp_t             getMaxAllowedTimestamp() const  { return clocksPerFrame;        }
+        timestamp_t             getMaxAllowedTimestamp() const  { return timeBase + clocksPerFrame;     }
+        timestamp_t             getTimeBase() const             { return timeBase;                      }
         int                     getSampleRate() const           { return sampleRate;            }
         bool                    isStereo() const                { return stereo;                }
+        std::size_t             getMemoryUsage() const          { return (transitionBuffer[0].capacity() + transitionBuffer[1].capacity()) * sizeof(float);    }
 
     private:
         // Interface for the APU
@@ -45,6 +49,7 @@ namespace schcore
             void                reset();
             void                setSamplerate(int samplerate);
             float               samp(float in);
+            void                serialize(StateStream& s);
 
         private:
             float               prev_out = 0;
@@ -59,6 +64,7 @@ namespace schcore
             void                reset();
             void                setSamplerate(int samplerate);
             float               samp(float in);
+            void                serialize(StateStream& s);
 
         private:
             float               prev_in = 0;
@@ -78,6 +84,7 @@ namespace schcore
         timestamp_t             timeScalar;
         timestamp_t             timeOverflow;
         int                     timeShift;
+        timestamp_t             timeBase;           // audio timestamp of the start of the transition buffer (only moves with a monotonic timeline)
 
 
         float                   outSample[2];
@@ -20,6 +20,17 @@ namespace schcore
         timestamp_t cputick = calcTicksToRun(cpuTimestamp, cputarget);
         timestamp_t audtick = calcTicksToRun(audTimestamp, audiotarget);
 
+        /////////////////////////////////
+        //  CPU-visible stuff is run all in one clump first.  It doesn't depend on the audio side, and running it
+        //    in audio-sized steps would make any events it predicts relative to the wrong time (they're relative
+        //    to the APU's current time, which is the end of the clump).  This also means the CPU side runs the
+        //    same whether or not audio is being pulled.
+        if(cputick > 0)
+        {
+            doTicks( cputick, false, true );
+            cpuTimestamp += (cputick * clockRate);
+        }
+
         //  Start by doing an update of 0 steps, since output may have an immediate
         //    change due to a register write
         timestamp_t step = 0;
@@ -28,10 +39,9 @@ namespace schcore
 
         while(audtick > 0)
         {
-            out = doTicks( step, true, (cputick > 0) );
+            out = doTicks( step, true, false );
 
             audTimestamp += (step * clockRate);
-            if(cputick > 0)             cpuTimestamp += (step * clockRate);
 
             if(useRawOutput)
             {
@@ -53,20 +63,7 @@ namespace schcore
             }
 
             audtick -= step;
-            if(cputick > 0)             cputick -= step;
-
             step = std::min( audtick, clocksToNextUpdate() );
-
-            if(cputick > 0)             step = std::min( step, cputick );
-        }
-
-        /////////////////////////////////
-        // So audio has all been updated.  If there is CPU that still needs updating, we can run that all
-        //   in one clump
-        if(cputick > 0)
-        {
-            doTicks( cputick, false, true );
-            cpuTimestamp += (cputick * clockRate);
         }
     }
 
@@ -8,6 +8,7 @@
 #include "schpunetypes.h"
 #include "audiotimestampholder.h"
 #include "audiosettings.h"
+#include "statestream.h"
 
 
 namespace schcore
@@ -30,8 +31,10 @@ namespace schcore
         timestamp_t             getClockRate() const                                    { return clockRate;         }
 
         void                    channelHardReset()                                      { prevOut = 0;  audTimestamp = cpuTimestamp = 0;        }
+        void                    channelSerialize(StateStream& s)                        { s(prevOut);   s.time(audTimestamp);   s.time(cpuTimestamp);   }
 
         void                    updateSettings(const AudioSettings& settings, ChannelId chanid);
+        std::size_t             getMemoryUsage() const          { return (outputLevels[0].capacity() + outputLevels[1].capacity()) * sizeof(float);     }
 
         virtual void            makeSilent() = 0;       // for when NSF tracks are changed, all channels need to be turned off somehow
 
@@ -0,0 +1,314 @@
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+#include <chrono>
+#include <exception>
+#include <algorithm>
+#include "batchrunner.h"
+#include "nes.h"
+#include "error.h"
+
+namespace schcore
+{
+    //////////////////////////////////////////////////
+    //  The worker pool
+    //    Workers sleep between runs.  During a run, each one takes instances from the front of its own queue
+    //  (or the back of someone else's), runs a frame, and puts them on the back of its own queue.  'active' counts
+    //  the instances that aren't finished yet -- the run is over when it hits 0.
+
+    struct BatchRunner::Pool
+    {
+        struct Worker
+        {
+            std::mutex                      lock;
+            std::deque<int>                 queue;
+            std::vector<char>               audio;          // leftover audio gets dumped here
+        };
+
+        std::vector<std::unique_ptr<Worker>>    workers;
+        std::vector<std::thread>                threads;
+
+        // the current run
+        std::vector<std::unique_ptr<Nes>>*      instances = nullptr;
+        std::vector<int>                        framesDone;
+        int                                     frames = 0;
+        FrameOptions                            options;
+        const FrameCallback*                    callback = nullptr;
+        std::atomic<int>                        queued;         // instances sitting in a queue
+        std::atomic<int>                        active;         // instances with frames left
+        std::atomic<int>                        sleepers;       // workers waiting for something to steal
+        std::atomic<u64>                        framesRun;
+        std::atomic<bool>                       failed;
+
+        std::mutex                              lock;           // for everything below, and for waking workers
+        std::condition_variable                 wake;           // a run started (or we're shutting down)
+        std::condition_variable                 more;           // something was queued, or the run is over
+        std::condition_variable                 finished;       // every worker is done with the run
+        u64                                     runId = 0;
+        int                                     busy = 0;
+        bool                                    quit = false;
+        std::exception_ptr                      error;
+
+        explicit Pool(int count)
+            : queued(0), active(0), sleepers(0), framesRun(0), failed(false)
+        {
+            for(int i = 0; i < count; ++i)
+                workers.emplace_back( new Worker );
+            for(int i = 0; i < count; ++i)
+                threads.emplace_back( [this, i] { workerMain(i); } );
+        }
+
+        ~Pool()
+        {
+            {
+                std::lock_guard<std::mutex> lk(lock);
+                quit = true;
+            }
+            wake.notify_all();
+            for(auto& t : threads)
+                t.join();
+        }
+
+        void run(std::vector<std::unique_ptr<Nes>>& inst, int count, const FrameOptions& opts, const FrameCallback* cb)
+        {
+            instances = &inst;
+            frames =    count;
+            options =   opts;
+            callback =  cb;
+            framesDone.assign(inst.size(), 0);
+            failed = false;
+            error = nullptr;
+
+            // deal the instances out
+            for(std::size_t i = 0; i < inst.size(); ++i)
+                workers[i % workers.size()]->queue.push_back( static_cast<int>(i) );
+            queued = active = static_cast<int>(inst.size());
+
+            std::unique_lock<std::mutex> lk(lock);
+            busy = static_cast<int>(workers.size());
+            ++runId;
+            wake.notify_all();
+            finished.wait(lk, [this] { return busy == 0; });
+
+            if(error)
+                std::rethrow_exception(error);
+        }
+
+    private:
+        void workerMain(int w)
+        {
+            u64 seen = 0;
+            std::unique_lock<std::mutex> lk(lock);
+            for(;;)
+            {
+                wake.wait(lk, [&] { return quit || runId != seen; });
+                if(quit)
+                    return;
+                seen = runId;
+
+                lk.unlock();
+                work(w);
+                lk.lock();
+
+                if(--busy == 0)
+                    finished.notify_all();
+            }
+        }
+
+        void work(int w)
+        {
+            for(;;)
+            {
+                int i = take(w);
+                if(i < 0)
+                {
+                    std::unique_lock<std::mutex> lk(lock);
+                    ++sleepers;
+                    more.wait(lk, [this] { return queued > 0 || active == 0; });
+                    --sleepers;
+                    if(active == 0)
+                        return;
+                    continue;
+                }
+
+                if(!failed && runFrame(w, i))
+                    put(w, i);
+                else if(--active == 0)
+                {
+                    std::lock_guard<std::mutex> lk(lock);
+                    more.notify_all();
+                }
+            }
+        }
+
+        int take(int w)
+        {
+            const int count = static_cast<int>(workers.size());
+            for(int k = 0; k < count; ++k)
+            {
+                Worker& v = *workers[(w + k) % count];
+                std::lock_guard<std::mutex> lk(v.lock);
+                if(v.queue.empty())
+                    continue;
+
+                int i;
+                if(k == 0)  { i = v.queue.front();     v.queue.pop_front();    }       // ours
+                else        { i = v.queue.back();      v.queue.pop_back();     }       // stolen
+                --queued;
+                return i;
+            }
+            return -1;
+        }
+
+        void put(int w, int i)
+        {
+            bool spare;     // only wake someone up if there's more here than we're about to take back
+            {
+                std::lock_guard<std::mutex> lk(workers[w]->lock);
+                workers[w]->queue.push_back(i);
+                spare = workers[w]->queue.size() > 1;
+            }
+            ++queued;
+            if(spare && sleepers > 0)
+            {
+                std::lock_guard<std::mutex> lk(lock);
+                more.notify_one();
+            }
+        }
+
+        bool runFrame(int w, int i)        // returns true if the instance has more frames to run
+        {
+            try
+            {
+                Nes& nes = *(*instances)[i];
+                const int frame = framesDone[i]++;
+                nes.doFrame(options);
+                ++framesRun;
+
+                bool keepgoing = framesDone[i] < frames;
+                if(callback && !(*callback)(nes, i, frame))
+                    keepgoing = false;
+
+                if(options.audio)
+                {
+                    auto& audio = workers[w]->audio;
+                    int siz = nes.getAvailableAudioSize();
+                    if(siz > static_cast<int>(audio.size()))
+                        audio.resize(siz);
+                    nes.getAudio(audio.data(), siz, nullptr, 0);
+                }
+                return keepgoing;
+            }
+            catch(...)
+            {
+                std::lock_guard<std::mutex> lk(lock);
+                if(!error)
+                    error = std::current_exception();
+                failed = true;
+                return false;
+            }
+        }
+    };
+
+    ////////////////////////////////////////////////////
+    namespace
+    {
+        NesFile loadNesFile(const char* filename)
+        {
+            NesFile f;
+            auto str = f.loadFile(filename);
+            if(!str.empty())        throw Error(str);
+            return f;
+        }
+    }
+
+    BatchRunner::BatchRunner(NesFile&& f, int threads)
+        : file( std::move(f) )
+    {
+        if(threads <= 0)
+            threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+
+        file.shareRom();
+        pool.reset( new Pool(threads) );
+    }
+
+    BatchRunner::BatchRunner(const char* filename, int threads)
+        : BatchRunner( loadNesFile(filename), threads )
+    {
+    }
+
+    BatchRunner::~BatchRunner()
+    {
+    }
+
+    int BatchRunner::addInstances(int count)
+    {
+        int first = getInstanceCount();
+        for(int i = 0; i < count; ++i)
+        {
+            std::unique_ptr<Nes> nes( new Nes );
+            nes->copyAndLoadFile(file);
+            instances.push_back( std::move(nes) );
+        }
+        return first;
+    }
+
+    int BatchRunner::getThreadCount() const
+    {
+        return static_cast<int>(pool->workers.size());
+    }
+
+    void BatchRunner::run(int frames, const FrameOptions& options, const FrameCallback& callback)
+    {
+        if(frames <= 0 || instances.empty())
+            return;
+
+        std::exception_ptr error;
+        pool->framesRun = 0;
+        auto start = std::chrono::steady_clock::now();
+        try
+        {
+            pool->run(instances, frames, options, callback ? &callback : nullptr);
+        }
+        catch(...)
+        {
+            error = std::current_exception();
+        }
+        framesRun += pool->framesRun;
+        secondsRun += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if(error)
+            std::rethrow_exception(error);
+    }
+
+    BatchStats BatchRunner::getStats() const
+    {
+        BatchStats out;
+        out.frames =            framesRun;
+        out.seconds =           secondsRun;
+        out.framesPerSecond =   secondsRun > 0 ? framesRun / secondsRun : 0;
+
+        if(!instances.empty())
+        {
+            std::size_t total = 0;
+            for(auto& i : instances)
+                total += i->getMemoryUsage();
+            out.instanceMemory = total / instances.size();
+        }
+        for(auto chips : { &file.prgRomChips, &file.chrRomChips })
+        {
+            for(auto& chip : *chips)
+                out.sharedMemory += chip.getSize();
+        }
+        return out;
+    }
+
+    void BatchRunner::clearStats()
+    {
+        framesRun = 0;
+        secondsRun = 0;
+    }
+}
@@ -18,12 +18,115 @@ namespace schcore
         if(info.hardReset)
         {
             ppuBus->setIoDevice(this);
+            chrCache.clear();
+            chrCacheUsed = !cartWatchesChrReads();
+            ppuBus->setChrCache( chrCacheUsed ? &chrCache : nullptr );
+            for(int i = 0; i < 0x08; ++i)
+                setChrPage(i, chrPages[i]);
             mir_hdr();
+            for(auto& i : prgReaderSet)     i = false;
+            for(auto& i : prgWriterSet)     i = false;
+            buildStateRegions();
         }
 
         cartReset(info);
     }
 
+    /////////////////////////////////////////////
+    //  Save states
+    void Cartridge::serialize(StateStream& s)
+    {
+        subSystem_Serialize(s);
+
+        // ROM can't change, so only RAM is saved
+        for(auto chips : { &loadedFile->prgRamChips, &loadedFile->chrRamChips })
+        {
+            for(auto& chip : *chips)
+            {
+                s(chip.readable);
+                s(chip.writable);
+                s.bytes( chip.getData(), chip.getSize() );
+            }
+        }
+
+        for(auto& pg : prgPages)    serializePage(s, pg);
+        for(auto& pg : chrPages)    serializePage(s, pg);
+        for(auto& pg : ntPages)     serializePage(s, pg);
+
+        cartSerialize(s);
+
+        if(s.isLoading())
+        {
+            for(int i = 0; i < 0x10; ++i)
+                syncDirectPrg(i);
+
+            if(chrCacheUsed)
+            {
+                for(auto& chip : loadedFile->chrRamChips)
+                    chrCache.invalidate( chip.getData(), chip.getSize() );
+                for(int i = 0; i < 0x08; ++i)
+                    chrCache.setSlot(i, chrPages[i]);
+            }
+        }
+    }
+
+    void Cartridge::buildStateRegions()
+    {
+        stateRegions.clear();
+        for(auto chips : { &loadedFile->prgRomChips, &loadedFile->prgRamChips, &loadedFile->chrRomChips, &loadedFile->chrRamChips })
+        {
+            for(auto& chip : *chips)
+                stateRegions.push_back( { chip.getData(), chip.getSize(), &chip.readable, &chip.writable } );
+        }
+        for(int i = 0; i < 2; ++i)
+        {
+            auto nt = ppu->getNt(i);
+            stateRegions.push_back( { nt.mem, nt.mask + 1, nt.readable, nt.writable } );
+        }
+    }
+
+    void Cartridge::serializePage(StateStream& s, ChipPage& pg)
+    {
+        s32 region = -1;
+        u32 offset = 0;
+        u32 mask = static_cast<u32>(pg.mask);
+
+        if(!s.isLoading() && pg.mem)
+        {
+            for(std::size_t i = 0; i < stateRegions.size(); ++i)
+            {
+                auto& r = stateRegions[i];
+                if(pg.mem >= r.mem && pg.mem < r.mem + r.size)
+                {
+                    region = static_cast<s32>(i);
+                    offset = static_cast<u32>(pg.mem - r.mem);
+                    break;
+                }
+            }
+        }
+
+        s(region);
+        s(offset);
+        s(mask);
+
+        if(s.isLoading())
+        {
+            if(region < 0)
+            {
+                pg = ChipPage();
+                return;
+            }
+            if(static_cast<std::size_t>(region) >= stateRegions.size() || offset + mask >= stateRegions[region].size)
+                throw Error("Save state is corrupt (bad memory page)");
+
+            auto& r = stateRegions[region];
+            pg.mem =        r.mem + offset;
+            pg.readable =   r.readable;
+            pg.writable =   r.writable;
+            pg.mask =       mask;
+        }
+    }
+
     u8 Cartridge::busConflict(u16 a, u8 v)
     {
         u8 out = v;
@@ -33,22 +136,50 @@ namespace schcore
 
     void Cartridge::setDefaultPrgCallbacks()
     {
-        cpuBus->addPeeker( 0x6, 0xF, this, &Cartridge::onPeekPrg );
-        cpuBus->addReader( 0x6, 0xF, this, &Cartridge::onReadPrg );
-        cpuBus->addWriter( 0x6, 0x7, this, &Cartridge::onWritePrg );
+        cpuBus->addPeeker<Cartridge, &Cartridge::onPeekPrg>( 0x6, 0xF, this );
+        cpuBus->addReader<Cartridge, &Cartridge::onReadPrg>( 0x6, 0xF, this );
+        cpuBus->addWriter<Cartridge, &Cartridge::onWritePrg>( 0x6, 0x7, this );
+        for(int i = 0x6; i <= 0xF; ++i)     prgReaderSet[i] = true;
+        for(int i = 0x6; i <= 0x7; ++i)     prgWriterSet[i] = true;
+        for(int i = 0x6; i <= 0xF; ++i)     syncDirectPrg(i);
 
         swapPrg_8k( 6, 0, true );       // TODO -- is this desired?
     }
     
     void Cartridge::setPrgReaders(int start, int stop)
     {
-        cpuBus->addPeeker( start, stop, this, &Cartridge::onPeekPrg );
-        cpuBus->addReader( start, stop, this, &Cartridge::onReadPrg );
+        cpuBus->addPeeker<Cartridge, &Cartridge::onPeekPrg>( start, stop, this );
+        cpuBus->addReader<Cartridge, &Cartridge::onReadPrg>( start, stop, this );
+        for(int i = start; i <= stop; ++i)
+        {
+            prgReaderSet[i] = true;
+            syncDirectPrg(i);
+        }
     }
 
     void Cartridge::setPrgWriters(int start, int stop)
     {
-        cpuBus->addWriter( start, stop, this, &Cartridge::onWritePrg );
+        cpuBus->addWriter<Cartridge, &Cartridge::onWritePrg>( start, stop, this );
+        for(int i = start; i <= stop; ++i)
+        {
+            prgWriterSet[i] = true;
+            syncDirectPrg(i);
+        }
+    }
+
+    void Cartridge::syncDirectPrg(int slot)
+    {
+        // Give the bus direct pointers for each 256-byte page in this slot, so plain PRG reads/writes
+        //   don't have to go through our procs.  Chips smaller than 256 bytes can't be mapped this way.
+        const ChipPage& pg = prgPages[slot];
+        for(int i = 0; i < 0x10; ++i)
+        {
+            u16 a = static_cast<u16>((slot << 12) | (i << 8));
+            u8* mem = (pg.mem && pg.mask >= 0xFF) ? (pg.mem + ((i << 8) & pg.mask)) : nullptr;
+
+            if(prgReaderSet[slot])      cpuBus->setDirectRead(  a, *pg.readable ? mem : nullptr );
+            if(prgWriterSet[slot])      cpuBus->setDirectWrite( a, *pg.writable ? mem : nullptr );
+        }
     }
 
     void Cartridge::clearPrgRam(u8 v)
@@ -100,6 +231,7 @@ namespace schcore
 
         auto chip = getFirstPrgChip(ram);
         prgPages[slot & 0x0F] = chip->get4kPage(page);
+        syncDirectPrg(slot & 0x0F);
     }
     void Cartridge::swapPrg_8k(int slot, int page, bool ram)
     {
@@ -109,6 +241,7 @@ namespace schcore
         auto chip = getFirstPrgChip(ram);
         prgPages[ slot    & 0x0F] = chip->get4kPage(page);
         prgPages[(slot+1) & 0x0F] = chip->get4kPage(page+1);
+        for(int i = 0; i < 2; ++i)      syncDirectPrg((slot+i) & 0x0F);
     }
     void Cartridge::swapPrg_16k(int slot, int page, bool ram)
     {
@@ -120,6 +253,7 @@ namespace schcore
         prgPages[(slot+1) & 0x0F] = chip->get4kPage(page+1);
         prgPages[(slot+2) & 0x0F] = chip->get4kPage(page+2);
         prgPages[(slot+3) & 0x0F] = chip->get4kPage(page+3);
+        for(int i = 0; i < 4; ++i)      syncDirectPrg((slot+i) & 0x0F);
     }
     void Cartridge::swapPrg_32k(int slot, int page, bool ram)
     {
@@ -135,16 +269,24 @@ namespace schcore
         prgPages[(slot+5) & 0x0F] = chip->get4kPage(page+5);
         prgPages[(slot+6) & 0x0F] = chip->get4kPage(page+6);
         prgPages[(slot+7) & 0x0F] = chip->get4kPage(page+7);
+        for(int i = 0; i < 8; ++i)      syncDirectPrg((slot+i) & 0x0F);
     }
 
     ///////////////////////////////////////
     //  CHR
+    void Cartridge::setChrPage(int slot, const ChipPage& pg)
+    {
+        chrPages[slot & 0x07] = pg;
+        if(chrCacheUsed)
+            chrCache.setSlot(slot, pg);
+    }
+
     void Cartridge::swapChr_1k(int slot, int page, bool ram)
     {
         ppu->catchUp();
         
         auto chip = getFirstChrChip(ram);
-        chrPages[slot & 0x07] = chip->get1kPage(page);
+        setChrPage( slot,   chip->get1kPage(page) );
     }
     void Cartridge::swapChr_2k(int slot, int page, bool ram)
     {
@@ -152,8 +294,8 @@ namespace schcore
         page <<= 1;
         
         auto chip = getFirstChrChip(ram);
-        chrPages[ slot    & 0x07] = chip->get1kPage(page);
-        chrPages[(slot+1) & 0x07] = chip->get1kPage(page+1);
+        setChrPage( slot,   chip->get1kPage(page) );
+        setChrPage( slot+1, chip->get1kPage(page+1) );
     }
     void Cartridge::swapChr_4k(int slot, int page, bool ram)
     {
@@ -161,10 +303,10 @@ namespace schcore
         page <<= 2;
 
         auto chip = getFirstChrChip(ram);
-        chrPages[ slot    & 0x07] = chip->get1kPage(page);
-        chrPages[(slot+1) & 0x07] = chip->get1kPage(page+1);
-        chrPages[(slot+2) & 0x07] = chip->get1kPage(page+2);
-        chrPages[(slot+3) & 0x07] = chip->get1kPage(page+3);
+        setChrPage( slot,   chip->get1kPage(page) );
+        setChrPage( slot+1, chip->get1kPage(page+1) );
+        setChrPage( slot+2, chip->get1kPage(page+2) );
+        setChrPage( slot+3, chip->get1kPage(page+3) );
     }
     void Cartridge::swapChr_8k(int slot, int page, bool ram)
     {
@@ -172,14 +314,14 @@ namespace schcore
         page <<= 3;
 
         auto chip = getFirstChrChip(ram);
-        chrPages[ slot    & 0x07] = chip->get1kPage(page);
-        chrPages[(slot+1) & 0x07] = chip->get1kPage(page+1);
-        chrPages[(slot+2) & 0x07] = chip->get1kPage(page+2);
-        chrPages[(slot+3) & 0x07] = chip->get1kPage(page+3);
-        chrPages[(slot+4) & 0x07] = chip->get1kPage(page+4);
-        chrPages[(slot+5) & 0x07] = chip->get1kPage(page+5);
-        chrPages[(slot+6) & 0x07] = chip->get1kPage(page+6);
-        chrPages[(slot+7) & 0x07] = chip->get1kPage(page+7);
+        setChrPage( slot,   chip->get1kPage(page) );
+        setChrPage( slot+1, chip->get1kPage(page+1) );
+        setChrPage( slot+2, chip->get1kPage(page+2) );
+        setChrPage( slot+3, chip->get1kPage(page+3) );
+        setChrPage( slot+4, chip->get1kPage(page+4) );
+        setChrPage( slot+5, chip->get1kPage(page+5) );
+        setChrPage( slot+6, chip->get1kPage(page+6) );
+        setChrPage( slot+7, chip->get1kPage(page+7) );
     }
 
     ////////////////////////////////////////////////
@@ -228,8 +370,14 @@ namespace schcore
     
     void Cartridge::onPpuWrite(u16 a, u8 v)
     {
-        if(a & 0x2000)      ntPages[(a >> 10) & 3].memWrite(a,v);
-        else                chrPages[(a >> 10) & 7].memWrite(a,v);
+        auto& pg = (a & 0x2000) ? ntPages[(a >> 10) & 3] : chrPages[(a >> 10) & 7];
+        pg.memWrite(a,v);
+
+        if(chrCacheUsed && *pg.writable)
+        {
+            if(a & 0x2000)  chrCache.invalidatePage(pg.mem);        // only matters if CHR is mapped in as a nametable
+            else            chrCache.onWrite(a >> 10);
+        }
     }
     void Cartridge::onPpuRead(u16 a, u8& v)
     {
@@ -245,6 +393,8 @@ namespace schcore
         {
             i.readable = i.writable = (v != 0);
         }
+        for(int i = 0; i < 0x10; ++i)
+            syncDirectPrg(i);
     }
 }
 
@@ -8,6 +8,7 @@
 #include "error.h"
 #include "ppubus.h"
 #include "cpubus.h"
+#include "chrcache.h"
 
 namespace schcore
 {
@@ -27,6 +28,8 @@ namespace schcore
             loadedFile = &file;
             cartLoad(file);
         }
+        void serialize(StateStream& s);                 // should not override -- override cartSerialize instead
+        std::size_t getMemoryUsage() const { return chrCache.getMemoryUsage(); }     // heap memory (the CHR cache)
         
         // PpuIo stuff -- can override
         virtual     void onPpuWrite(u16 a, u8 v) override;
@@ -38,6 +41,8 @@ namespace schcore
         NesFile*        loadedFile;
         virtual void    cartLoad(NesFile& file) {}
         virtual void    cartReset(const ResetInfo& info) = 0;
+        virtual void    cartSerialize(StateStream&) {}      // mapper registers.  Pages/RAM are handled already
+        virtual bool    cartWatchesChrReads() const { return false; }   // true if onPpuRead has to see every CHR read (turns off the CHR cache)
 
         ////////////////////////////////////////////////
         //  Useful on reset
@@ -84,12 +89,31 @@ namespace schcore
         Apu*            apu;
         Ppu*            ppu;
         ChipPage        prgPages[0x10];
+        bool            prgReaderSet[0x10];     // true for pages where our PRG procs are on the bus, so
+        bool            prgWriterSet[0x10];     //   we can give it direct pointers to PRG memory
         ChipPage        chrPages[0x08];
         ChipPage        ntPages[0x04];
+        ChrCache        chrCache;               // kept matching chrPages (only if it's used)
+        bool            chrCacheUsed = false;
+        void            setChrPage(int slot, const ChipPage& pg);
 
         MemoryChip      dummyChip;
 
+        //  Save states store pages as an offset into one of these (every chip, plus the PPU's nametables),
+        //    rather than as pointers
+        struct StateRegion
+        {
+            u8*             mem;
+            std::size_t     size;
+            const bool*     readable;
+            const bool*     writable;
+        };
+        std::vector<StateRegion>    stateRegions;
+        void            buildStateRegions();
+        void            serializePage(StateStream& s, ChipPage& pg);
+
         MemoryChip*     getFirstPrgChip(bool preferram);
+        void            syncDirectPrg(int slot);
         MemoryChip*     getFirstChrChip(bool preferram);
     };
 
@@ -0,0 +1,54 @@
+
+#include "chrcache.h"
+#include "tiledecode.h"
+
+namespace schcore
+{
+    void ChrCache::clear()
+    {
+        pages.clear();
+        for(auto& i : slots)    i = Slot();
+    }
+
+    void ChrCache::setSlot(int slot, const ChipPage& page)
+    {
+        Slot& s = slots[slot & 7];
+        if(!page.mem)
+        {
+            s = Slot();
+            return;
+        }
+
+        Page& pg = pages[page.mem];
+        pg.mem = page.mem;
+        pg.mask = page.mask;
+        s.page = &pg;
+        s.readable = page.readable;
+    }
+
+    void ChrCache::invalidate(const u8* mem, std::size_t size)
+    {
+        for(auto& i : pages)
+        {
+            if(i.first >= mem && i.first < mem + size)
+                i.second.valid = false;
+        }
+    }
+
+    void ChrCache::invalidatePage(const u8* mem)
+    {
+        auto i = pages.find(mem);
+        if(i != pages.end())
+            i->second.valid = false;
+    }
+
+    void ChrCache::decode(Page& pg)
+    {
+        for(int i = 0; i < 0x200; ++i)
+        {
+            std::size_t a = ((i & 0x01F8) << 1) | (i & 7);
+            pg.rows[i] = tiledecode::spread( pg.mem[a & pg.mask], pg.mem[(a | 8) & pg.mask] );
+        }
+        pg.valid = true;
+    }
+}
@@ -0,0 +1,60 @@
+#ifndef SCHPUNE_NESCORE_CHRCACHE_H_INCLUDED
+#define SCHPUNE_NESCORE_CHRCACHE_H_INCLUDED
+
+#include <unordered_map>
+#include "schpunetypes.h"
+#include "memorychip.h"
+
+namespace schcore
+{
+    //////////////////////////////////////////////////
+    //  ChrCache
+    //    CHR pages already spread out into pixels (tiledecode::spread form -- a u64 of 8 2-bit pixels per tile
+    //  row), so the renderer can get a whole row in one lookup instead of two PpuBus reads.
+    //
+    //    Decoded pages are keyed by the 1K page of chip memory they came from, and built the first time they're
+    //  used.  The 8 slots ($0000-$1FFF) just point at them, so a CHR swap only repoints a slot.  The Cartridge
+    //  keeps the slots matching its CHR pages, and calls invalidate() when CHR-RAM is written or loaded.
+    //
+    //    The cache is only handed out (see PpuBus::getChrCache) when the mapper doesn't need to see CHR reads.
+
+    class ChrCache
+    {
+    public:
+        void            clear();
+        void            setSlot(int slot, const ChipPage& page);
+        void            invalidate(const u8* mem, std::size_t size);        // any pages in this memory have changed
+        void            invalidatePage(const u8* mem);                      // the page starting here has changed
+        void            onWrite(int slot)   { if(slots[slot & 7].page)  slots[slot & 7].page->valid = false;    }
+        std::size_t     getMemoryUsage() const      { return pages.size() * (sizeof(Page) + sizeof(void*) * 4);            }
+
+        u64             row(u16 a)          // the row at this address (the plane bit, $0008, is ignored)
+        {
+            const Slot& s = slots[(a >> 10) & 7];
+            if(!s.page || !*s.readable)     return 0;       // open bus reads back 0 on this bus
+            if(!s.page->valid)              decode(*s.page);
+            return s.page->rows[ ((a >> 1) & 0x01F8) | (a & 7) ];
+        }
+
+    private:
+        struct Page
+        {
+            const u8*       mem = nullptr;
+            std::size_t     mask = 0;
+            bool            valid = false;
+            u64             rows[0x200];        // 64 tiles * 8 rows
+        };
+        struct Slot
+        {
+            Page*           page = nullptr;
+            const bool*     readable = &ChipPage::alwaysFalse;
+        };
+
+        std::unordered_map<const u8*, Page>     pages;
+        Slot                                    slots[8];
+
+        void            decode(Page& pg);
+    };
+}
+
+#endif
@@ -1,4 +1,6 @@
 
+#include <cstring>
+#include <algorithm>
 #include "cpu.h"
 #include "cpubus.h"
 #include "resetinfo.h"
@@ -21,11 +23,8 @@ namespace schcore
         wantInterrupt = bus->isNmiPending() || ( !cpu.getI() && bus->isIrqPending() );
     }
 
-    void Cpu::consumeCycle()
+    void Cpu::runEvents()
     {
-        if(cpuJammed)       return;
-
-        cyc();
         eventManager->check(curCyc());
     }
 
@@ -45,6 +44,7 @@ namespace schcore
     {
         cpuJammed = false;
         wantInterrupt = wantReset = true;
+        idleLoop = IdleLoop();
 
         if(info.hardReset)
         {
@@ -53,6 +53,7 @@ namespace schcore
             eventManager = info.eventManager;
 
             subSystem_HardReset(info.cpu, info.region.cpuClockBase);
+            clearStats();
             cpu.A = 0;
             cpu.X = 0;
             cpu.Y = 0;
@@ -64,8 +65,25 @@ namespace schcore
         // I flag will be set when the reset interrupt is performed.
     }
 
+    ////////////////////////////////////////////////////
+    //  Save states
+    void Cpu::serialize(StateStream& s)
+    {
+        subSystem_Serialize(s);
+        cpu.serialize(s);
+        s(wantInterrupt);
+        s(wantReset);
+        s(cpuJammed);
+
+        // eventDeadline is restored by the EventManager.  The idle loop is just a cache of what the CPU has
+        //   seen recently -- it'll pick it up again on its own
+        if(s.isLoading())
+            idleLoop = IdleLoop();
+    }
+
     ////////////////////////////////////////////////////
     //  Interrupts
+    template <bool Traced>
     void Cpu::performInterrupt(bool sw)
     {
         u16 vector = 0xFFFE;        // default to IRQ/BRK vector
@@ -97,7 +115,7 @@ namespace schcore
             // hijacking happens at this point
             if(bus->isNmiPending())
             {
-                if( *tracer )
+                if(Traced)
                     tracer->traceRawLine( "** NMI **" );
                 vector = 0xFFFA;
                 bus->acknowledgeNmi();
@@ -105,7 +123,7 @@ namespace schcore
             }
             else if(bus->isIrqPending())
             {
-                if( *tracer )
+                if(Traced)
                     tracer->traceRawLine( "** IRQ: " + bus->getPendingIrqName() + " **" );
                 sw = false;                 // does this get changed here?
             }
@@ -125,337 +143,520 @@ namespace schcore
     //  Run!
     void Cpu::run(timestamp_t runto)
     {
+        if(tracer->isOn())      runLoop<true>(runto);
+        else                    runLoop<false>(runto);
+
+        // a jammed CPU just sits there until the end of the run
         if(cpuJammed && (curCyc() < runto))
         {
             setMainTimestamp(runto);
         }
+    }
+
+#ifdef SCHPUNE_CPU_TABLE_DISPATCH
+    template <bool Traced, u8 Op>
+    void Cpu::tableOp(Cpu& c)
+    {
+        c.executeOp<Traced>( std::integral_constant<u8, Op>() );
+    }
+
+    template <bool Traced, std::size_t... Ops>
+    const Cpu::OpHandler* Cpu::opTable(std::index_sequence<Ops...>)
+    {
+        static const OpHandler table[] = { &Cpu::tableOp<Traced, static_cast<u8>(Ops)>... };
+        return table;
+    }
+#endif
 
-        while( curCyc() < runto )
+    template <bool Traced>
+    void Cpu::runLoop(timestamp_t runto)
+    {
+#ifdef SCHPUNE_CPU_TABLE_DISPATCH
+        const OpHandler* const ops = opTable<Traced>( std::make_index_sequence<0x100>() );
+#endif
+
+        u16 prevPc = cpu.PC;
+
+        while( !cpuJammed && (curCyc() < runto) )
         {
             /////////////////////////////////////
             // Are we to take an interrupt
             if(wantInterrupt)
             {
-                performInterrupt(false);
+                performInterrupt<Traced>(false);
                 continue;
             }
 
-            if( *tracer )
+            if(Traced)
                 tracer->traceCpuLine( cpu );
+            else if( static_cast<u16>(prevPc - cpu.PC) < maxIdleLoopBytes )     // (traced runs don't skip, so the trace is complete)
+            {
+                checkIdleLoop(prevPc, runto);
+                if(curCyc() >= runto)
+                    break;
+            }
+            prevPc = cpu.PC;
 
             /////////////////////////////////////
             // No interrupt, do an instruction
             u8 opcode = rd( cpu.PC++ );
-            switch(opcode)
+            ++instructionCount;
+#ifdef SCHPUNE_CPU_TABLE_DISPATCH
+            ops[opcode](*this);
+#else
+            executeOp<Traced>( opcode );
+#endif
+        }
+    }
+
+    ////////////////////////////////////////////////////
+    //  Idle loops
+    void Cpu::checkIdleLoop(u16 tail, timestamp_t runto)
+    {
+        auto& lp = idleLoop;
+        const timestamp_t now = curCyc();
+        const timestamp_t period = lp.cycles * getClockBase();
+
+        // Did we just go exactly once around the loop we armed last time, with no event in between?  (Events only
+        //   happen once the deadline is passed, and nothing but the loop body gets from the head back to the head
+        //   in exactly 'period').  If so, nothing has been written, so the body checked last time is still good.
+        bool oneLoop =  lp.armed && (lp.head == cpu.PC) && (lp.tail == tail) && (now - lp.time == period)
+                        && (now <= lp.deadline) && (eventDeadline == lp.deadline);
+        lp.armed = false;
+
+        if(!oneLoop)
+        {
+            // (no need to recheck a loop we've already rejected)
+            if(lp.head == cpu.PC && lp.tail == tail && !lp.cycles)
+                return;
+
+            lp.head =   cpu.PC;
+            lp.tail =   tail;
+            lp.cycles = idleLoopCycles(lp.head, lp.tail, lp.instructions);
+            if(!lp.cycles)
+                return;
+        }
+
+        // Nothing can be about to interrupt the loop
+        if(wantInterrupt || bus->isDmaPending() || bus->isNmiPending() || (!cpu.getI() && bus->isIrqPending()))
+            return;
+
+        // If the loop didn't change anything either, then every time around from here on will be the same.  Skip
+        //   whole loops up to the next event or the end of the run.
+        const u8 regs[5] = { cpu.A, cpu.X, cpu.Y, cpu.SP, cpu.getStatus(false) };
+        if(oneLoop && !std::memcmp(regs, lp.regs, sizeof(regs)))
+        {
+            timestamp_t loops = (std::min(eventDeadline, runto) - now) / period;
+            if(loops > 0)
             {
-                /* Branches */
-            case 0x10:  adBranch( !cpu.getN() );        break;  /* BPL  */
-            case 0x30:  adBranch(  cpu.getN() );        break;  /* BMI  */
-            case 0x50:  adBranch( !cpu.getV() );        break;  /* BVC  */
-            case 0x70:  adBranch(  cpu.getV() );        break;  /* BVS  */
-            case 0x90:  adBranch( !cpu.getC() );        break;  /* BCC  */
-            case 0xB0:  adBranch(  cpu.getC() );        break;  /* BCS  */
-            case 0xD0:  adBranch( !cpu.getZ() );        break;  /* BNE  */
-            case 0xF0:  adBranch(  cpu.getZ() );        break;  /* BEQ  */
-
-                /* Flag flip-flop   */
-            case 0x18:  adImplied(); cpu.setC(0);       break;  /* CLC  */
-            case 0x38:  adImplied(); cpu.setC(1);       break;  /* SEC  */
-            case 0x58:  adImplied(); cpu.setI(0);       break;  /* CLI  */
-            case 0x78:  adImplied(); cpu.setI(1);       break;  /* SEI  */
-            case 0xB8:  adImplied(); cpu.setV(0);       break;  /* CLV  */
-            case 0xD8:  adImplied(); cpu.setD(0);       break;  /* CLD  */
-            case 0xF8:  adImplied(); cpu.setD(1);       break;  /* SED  */
-
-                /* Stack push/pull  */
-            case 0x08:  adPush( cpu.getStatus(true) );  break;  /* PHP  */
-            case 0x28:  cpu.setStatus( adPull() );      break;  /* PLP  */
-            case 0x48:  adPush( cpu.A );                break;  /* PHA  */
-            case 0x68:  cpu.NZ( cpu.A = adPull() );     break;  /* PLA  */
-
-                /* Reg Xfer         */
-            case 0xAA:  adImplied(); cpu.NZ( cpu.X = cpu.A );   break;  /* TAX  */
-            case 0xA8:  adImplied(); cpu.NZ( cpu.Y = cpu.A );   break;  /* TAY  */
-            case 0xBA:  adImplied(); cpu.NZ( cpu.X = cpu.SP );  break;  /* TSX  */
-            case 0x8A:  adImplied(); cpu.NZ( cpu.A = cpu.X );   break;  /* TXA  */
-            case 0x9A:  adImplied();        cpu.SP = cpu.X;     break;  /* TXS  */
-            case 0x98:  adImplied(); cpu.NZ( cpu.A = cpu.Y );   break;  /* TYA  */
-
-                /* Misc */
-            case 0x00:  performInterrupt(true);         break;  /* BRK          */
-            case 0x4C:  full_JMP();                     break;  /* JMP $xxxx    */
-            case 0x6C:  full_JMP_Indirect();            break;  /* JMP ($xxxx)  */
-            case 0x20:  full_JSR();                     break;  /* JSR $xxxx    */
-            case 0xEA:  adImplied();                    break;  /* NOP          */
-            case 0x40:  full_RTI();                     break;  /* RTI          */
-            case 0x60:  full_RTS();                     break;  /* RTS          */
-
-                /* ADC  */
-            case 0x69:  ADC( adRdIm() );                break;
-            case 0x65:  ADC( adRdZp() );                break;
-            case 0x75:  ADC( adRdZx() );                break;
-            case 0x6D:  ADC( adRdAb() );                break;
-            case 0x7D:  ADC( adRdAx() );                break;
-            case 0x79:  ADC( adRdAy() );                break;
-            case 0x61:  ADC( adRdIx() );                break;
-            case 0x71:  ADC( adRdIy() );                break;
-                
-                /* AND  */
-            case 0x29:  AND( adRdIm() );                break;
-            case 0x25:  AND( adRdZp() );                break;
-            case 0x35:  AND( adRdZx() );                break;
-            case 0x2D:  AND( adRdAb() );                break;
-            case 0x3D:  AND( adRdAx() );                break;
-            case 0x39:  AND( adRdAy() );                break;
-            case 0x21:  AND( adRdIx() );                break;
-            case 0x31:  AND( adRdIy() );                break;
-
-                /* ASL  */
-            case 0x0A:  adImplied();    ASL(cpu.A);     break;
-            case 0x06:  adRWZp( &Cpu::ASL );            break;
-            case 0x16:  adRWZx( &Cpu::ASL );            break;
-            case 0x0E:  adRWAb( &Cpu::ASL );            break;
-            case 0x1E:  adRWAx( &Cpu::ASL );            break;
-
-                /* BIT  */
-            case 0x24:  BIT( adRdZp() );                break;
-            case 0x2C:  BIT( adRdAb() );                break;
-                
-                /* CMP  */
-            case 0xC9:  CMP( adRdIm() );                break;
-            case 0xC5:  CMP( adRdZp() );                break;
-            case 0xD5:  CMP( adRdZx() );                break;
-            case 0xCD:  CMP( adRdAb() );                break;
-            case 0xDD:  CMP( adRdAx() );                break;
-            case 0xD9:  CMP( adRdAy() );                break;
-            case 0xC1:  CMP( adRdIx() );                break;
-            case 0xD1:  CMP( adRdIy() );                break;
-                
-                /* CPX  */
-            case 0xE0:  CPX( adRdIm() );                break;
-            case 0xE4:  CPX( adRdZp() );                break;
-            case 0xEC:  CPX( adRdAb() );                break;
-                
-                /* CPY  */
-            case 0xC0:  CPY( adRdIm() );                break;
-            case 0xC4:  CPY( adRdZp() );                break;
-            case 0xCC:  CPY( adRdAb() );                break;
-                
-                /* DEC  */
-            case 0xCA:  adImplied();    DEC(cpu.X);     break;  /* DEX  */
-            case 0x88:  adImplied();    DEC(cpu.Y);     break;  /* DEY  */
-            case 0xC6:  adRWZp( &Cpu::DEC );            break;
-            case 0xD6:  adRWZx( &Cpu::DEC );            break;
-            case 0xCE:  adRWAb( &Cpu::DEC );            break;
-            case 0xDE:  adRWAx( &Cpu::DEC );            break;
-                
-                /* EOR  */
-            case 0x49:  EOR( adRdIm() );                break;
-            case 0x45:  EOR( adRdZp() );                break;
-            case 0x55:  EOR( adRdZx() );                break;
-            case 0x4D:  EOR( adRdAb() );                break;
-            case 0x5D:  EOR( adRdAx() );                break;
-            case 0x59:  EOR( adRdAy() );                break;
-            case 0x41:  EOR( adRdIx() );                break;
-            case 0x51:  EOR( adRdIy() );                break;
-                
-                /* INC  */
-            case 0xE8:  adImplied();    INC(cpu.X);     break;  /* INX  */
-            case 0xC8:  adImplied();    INC(cpu.Y);     break;  /* INY  */
-            case 0xE6:  adRWZp( &Cpu::INC );            break;
-            case 0xF6:  adRWZx( &Cpu::INC );            break;
-            case 0xEE:  adRWAb( &Cpu::INC );            break;
-            case 0xFE:  adRWAx( &Cpu::INC );            break;
-                
-                /* LDA  */
-            case 0xA9:  cpu.NZ( cpu.A = adRdIm() );     break;
-            case 0xA5:  cpu.NZ( cpu.A = adRdZp() );     break;
-            case 0xB5:  cpu.NZ( cpu.A = adRdZx() );     break;
-            case 0xAD:  cpu.NZ( cpu.A = adRdAb() );     break;
-            case 0xBD:  cpu.NZ( cpu.A = adRdAx() );     break;
-            case 0xB9:  cpu.NZ( cpu.A = adRdAy() );     break;
-            case 0xA1:  cpu.NZ( cpu.A = adRdIx() );     break;
-            case 0xB1:  cpu.NZ( cpu.A = adRdIy() );     break;
-                
-                /* LDX  */
-            case 0xA2:  cpu.NZ( cpu.X = adRdIm() );     break;
-            case 0xA6:  cpu.NZ( cpu.X = adRdZp() );     break;
-            case 0xB6:  cpu.NZ( cpu.X = adRdZy() );     break;
-            case 0xAE:  cpu.NZ( cpu.X = adRdAb() );     break;
-            case 0xBE:  cpu.NZ( cpu.X = adRdAy() );     break;
-                
-                /* LDY  */
-            case 0xA0:  cpu.NZ( cpu.Y = adRdIm() );     break;
-            case 0xA4:  cpu.NZ( cpu.Y = adRdZp() );     break;
-            case 0xB4:  cpu.NZ( cpu.Y = adRdZx() );     break;
-            case 0xAC:  cpu.NZ( cpu.Y = adRdAb() );     break;
-            case 0xBC:  cpu.NZ( cpu.Y = adRdAx() );     break;
-                
-                /* LSR  */
-            case 0x4A:  adImplied();    LSR(cpu.A);     break;
-            case 0x46:  adRWZp( &Cpu::LSR );            break;
-            case 0x56:  adRWZx( &Cpu::LSR );            break;
-            case 0x4E:  adRWAb( &Cpu::LSR );            break;
-            case 0x5E:  adRWAx( &Cpu::LSR );            break;
-                
-                /* ORA  */
-            case 0x09:  ORA( adRdIm() );                break;
-            case 0x05:  ORA( adRdZp() );                break;
-            case 0x15:  ORA( adRdZx() );                break;
-            case 0x0D:  ORA( adRdAb() );                break;
-            case 0x1D:  ORA( adRdAx() );                break;
-            case 0x19:  ORA( adRdAy() );                break;
-            case 0x01:  ORA( adRdIx() );                break;
-            case 0x11:  ORA( adRdIy() );                break;
-
-                /* ROL  */
-            case 0x2A:  adImplied();    ROL(cpu.A);     break;
-            case 0x26:  adRWZp( &Cpu::ROL );            break;
-            case 0x36:  adRWZx( &Cpu::ROL );            break;
-            case 0x2E:  adRWAb( &Cpu::ROL );            break;
-            case 0x3E:  adRWAx( &Cpu::ROL );            break;
-
-                /* ROR  */
-            case 0x6A:  adImplied();    ROR(cpu.A);     break;
-            case 0x66:  adRWZp( &Cpu::ROR );            break;
-            case 0x76:  adRWZx( &Cpu::ROR );            break;
-            case 0x6E:  adRWAb( &Cpu::ROR );            break;
-            case 0x7E:  adRWAx( &Cpu::ROR );            break;
-                
-                /* SBC  */
-            case 0xE9:  SBC( adRdIm() );                break;
-            case 0xE5:  SBC( adRdZp() );                break;
-            case 0xF5:  SBC( adRdZx() );                break;
-            case 0xED:  SBC( adRdAb() );                break;
-            case 0xFD:  SBC( adRdAx() );                break;
-            case 0xF9:  SBC( adRdAy() );                break;
-            case 0xE1:  SBC( adRdIx() );                break;
-            case 0xF1:  SBC( adRdIy() );                break;
-                
-                /* STA  */
-            case 0x85:  adWrZp( cpu.A );                break;
-            case 0x95:  adWrZx( cpu.A );                break;
-            case 0x8D:  adWrAb( cpu.A );                break;
-            case 0x9D:  adWrAx( cpu.A );                break;
-            case 0x99:  adWrAy( cpu.A );                break;
-            case 0x81:  adWrIx( cpu.A );                break;
-            case 0x91:  adWrIy( cpu.A );                break;
-                
-                /* STX  */
-            case 0x86:  adWrZp( cpu.X );                break;
-            case 0x96:  adWrZy( cpu.X );                break;
-            case 0x8E:  adWrAb( cpu.X );                break;
-                
-                /* STY  */
-            case 0x84:  adWrZp( cpu.Y );                break;
-            case 0x94:  adWrZx( cpu.Y );                break;
-            case 0x8C:  adWrAb( cpu.Y );                break;
-                
-                /////////////////////////////////////
-                // Unofficial ops
-                
-                /* One offs */
- case 0x0B: case 0x2B:  ANC( adRdIm() );                break;  /* ANC  */
-            case 0x4B:  ALR( adRdIm() );                break;  /* ALR  */
-            case 0x6B:  ARR( adRdIm() );                break;  /* ARR  */
-            case 0xCB:  AXS( adRdIm() );                break;  /* AXS  */
-            case 0xBB:  LAS( adRdAy() );                break;  /* LAS  */
-            case 0xEB:  SBC( adRdIm() );                break;  /* alternative SBC  */
-            case 0x9E:  adWrAy_xxx( cpu.X );            break;  /* SHX  */
-            case 0x9C:  adWrAx_xxx( cpu.Y );            break;  /* SHY  */
-            case 0x8B:  XAA( adRdIm() );                break;  /* XAA  */
-
-            case 0x9B:  cpu.SP = cpu.A & cpu.X; adWrAy_xxx( cpu.SP );     break;  /* TAS  */
-                
-                /* AHX  */
-            case 0x9F:  adWrAy_xxx( cpu.A & cpu.X );    break;
-            case 0x93:  adWrIy_xxx( cpu.A & cpu.X );    break;
-
-                /* DCP  */
-            case 0xC7:  adRWZp( &Cpu::DCP );            break;
-            case 0xD7:  adRWZx( &Cpu::DCP );            break;
-            case 0xCF:  adRWAb( &Cpu::DCP );            break;
-            case 0xDF:  adRWAx( &Cpu::DCP );            break;
-            case 0xDB:  adRWAy( &Cpu::DCP );            break;
-            case 0xC3:  adRWIx( &Cpu::DCP );            break;
-            case 0xD3:  adRWIy( &Cpu::DCP );            break;
-                
-                /* ISC  */
-            case 0xE7:  adRWZp( &Cpu::ISC );            break;
-            case 0xF7:  adRWZx( &Cpu::ISC );            break;
-            case 0xEF:  adRWAb( &Cpu::ISC );            break;
-            case 0xFF:  adRWAx( &Cpu::ISC );            break;
-            case 0xFB:  adRWAy( &Cpu::ISC );            break;
-            case 0xE3:  adRWIx( &Cpu::ISC );            break;
-            case 0xF3:  adRWIy( &Cpu::ISC );            break;
-
-                /* LAX  */
-            case 0xAB:  LAX( adRdIm() );                break;
-            case 0xA7:  LAX( adRdZp() );                break;
-            case 0xB7:  LAX( adRdZy() );                break;
-            case 0xAF:  LAX( adRdAb() );                break;
-            case 0xBF:  LAX( adRdAy() );                break;
-            case 0xA3:  LAX( adRdIx() );                break;
-            case 0xB3:  LAX( adRdIy() );                break;
-
-                /* NOP  */
-            case 0x1A: case 0x3A: case 0x5A: case 0x7A: case 0xDA: case 0xFA:   adImplied();break;
-            case 0x04: case 0x44: case 0x64:                                    adRdZp();   break;
-            case 0x14: case 0x34: case 0x54: case 0x74: case 0xD4: case 0xF4:   adRdZx();   break;
-            case 0x80: case 0x82: case 0x89: case 0xC2: case 0xE2:              adRdIm();   break;
-            case 0x0C:                                                          adRdAb();   break;
-            case 0x1C: case 0x3C: case 0x5C: case 0x7C: case 0xDC: case 0xFC:   adRdAx();   break;
-                
-                /* RLA  */
-            case 0x27:  adRWZp( &Cpu::RLA );            break;
-            case 0x37:  adRWZx( &Cpu::RLA );            break;
-            case 0x2F:  adRWAb( &Cpu::RLA );            break;
-            case 0x3F:  adRWAx( &Cpu::RLA );            break;
-            case 0x3B:  adRWAy( &Cpu::RLA );            break;
-            case 0x23:  adRWIx( &Cpu::RLA );            break;
-            case 0x33:  adRWIy( &Cpu::RLA );            break;
-                
-                /* RRA  */
-            case 0x67:  adRWZp( &Cpu::RRA );            break;
-            case 0x77:  adRWZx( &Cpu::RRA );            break;
-            case 0x6F:  adRWAb( &Cpu::RRA );            break;
-            case 0x7F:  adRWAx( &Cpu::RRA );            break;
-            case 0x7B:  adRWAy( &Cpu::RRA );            break;
-            case 0x63:  adRWIx( &Cpu::RRA );            break;
-            case 0x73:  adRWIy( &Cpu::RRA );            break;
-
-                /* SAX  */
-            case 0x87:  adWrZp( cpu.A & cpu.X );        break;
-            case 0x97:  adWrZy( cpu.A & cpu.X );        break;
-            case 0x8F:  adWrAb( cpu.A & cpu.X );        break;
-            case 0x83:  adWrIx( cpu.A & cpu.X );        break;
-                
-                /* SLO  */
-            case 0x07:  adRWZp( &Cpu::SLO );            break;
-            case 0x17:  adRWZx( &Cpu::SLO );            break;
-            case 0x0F:  adRWAb( &Cpu::SLO );            break;
-            case 0x1F:  adRWAx( &Cpu::SLO );            break;
-            case 0x1B:  adRWAy( &Cpu::SLO );            break;
-            case 0x03:  adRWIx( &Cpu::SLO );            break;
-            case 0x13:  adRWIy( &Cpu::SLO );            break;
-                
-                /* SRE  */
-            case 0x47:  adRWZp( &Cpu::SRE );            break;
-            case 0x57:  adRWZx( &Cpu::SRE );            break;
-            case 0x4F:  adRWAb( &Cpu::SRE );            break;
-            case 0x5F:  adRWAx( &Cpu::SRE );            break;
-            case 0x5B:  adRWAy( &Cpu::SRE );            break;
-            case 0x43:  adRWIx( &Cpu::SRE );            break;
-            case 0x53:  adRWIy( &Cpu::SRE );            break;
-
-                /* STP  */
-            case 0x02: case 0x12: case 0x22: case 0x32: case 0x42: case 0x52:
-            case 0x62: case 0x72: case 0x92: case 0xB2: case 0xD2: case 0xF2:
-                cpuJammed = true;
-                setMainTimestamp(runto);
-                break;
+                setMainTimestamp( now + (loops * period) );
+                bus->skipCycles( loops * lp.cycles );
+
+                ++idleSkips;
+                idleCyclesSkipped += loops * lp.cycles;
+                instructionCount += loops * lp.instructions;
             }
         }
+
+        lp.armed =      true;
+        lp.time =       curCyc();
+        lp.deadline =   eventDeadline;
+        std::memcpy(lp.regs, regs, sizeof(regs));
+    }
+
+    timestamp_t Cpu::idleLoopCycles(u16 head, u16 tail, int& instructions) const
+    {
+        //  Every instruction in the loop has to only read (no writes, no stack), and only from plain memory so
+        //    the reads have no side effects and nothing but the CPU could change what they see.  The body has
+        //    to run straight through to the last instruction, which is a branch or JMP back to the head.
+        //  Returns the number of cycles for one time around, or 0 if it isn't a loop we can skip.  'instructions'
+        //    gets the number of instructions in the loop.
+        auto stable = [this](int a) { return bus->getDirectRead(static_cast<u16>(a)) != nullptr;  };
+        auto byteAt = [this](int a) { return *bus->getDirectRead(static_cast<u16>(a));              };
+
+        timestamp_t cycles = 0;
+        const int end = head + static_cast<u16>(tail - head);
+        instructions = 0;
+        for(int pc = head; pc <= end; ++instructions)
+        {
+            if(!stable(pc) || !stable(pc+1) || !stable(pc+2))       return 0;
+
+            switch(byteAt(pc))
+            {
+                // implied
+            case 0xEA:  case 0xAA:  case 0xA8:  case 0x8A:  case 0x98:
+            case 0x18:  case 0x38:  case 0xB8:  case 0xD8:  case 0xF8:
+                cycles += 2;    pc += 1;    break;
+
+                // immediate
+            case 0xA9:  case 0xA2:  case 0xA0:  case 0xC9:  case 0xE0:  case 0xC0:  case 0x29:  case 0x09:  case 0x49:
+                cycles += 2;    pc += 2;    break;
+
+                // zero page
+            case 0xA5:  case 0xA6:  case 0xA4:  case 0xC5:  case 0xE4:  case 0xC4:  case 0x24:  case 0x25:  case 0x05:  case 0x45:
+                if(!stable( byteAt(pc+1) ))                             return 0;
+                cycles += 3;    pc += 2;    break;
+
+                // absolute
+            case 0xAD:  case 0xAE:  case 0xAC:  case 0xCD:  case 0xEC:  case 0xCC:  case 0x2C:  case 0x2D:  case 0x0D:  case 0x4D:
+                if(!stable( byteAt(pc+1) | (byteAt(pc+2) << 8) ))       return 0;
+                cycles += 4;    pc += 3;    break;
+
+                // the way back to the head
+            case 0x4C:
+                if(pc != end || (byteAt(pc+1) | (byteAt(pc+2) << 8)) != head)                           return 0;
+                ++instructions;
+                return cycles + 3;
+
+            case 0x10:  case 0x30:  case 0x50:  case 0x70:  case 0x90:  case 0xB0:  case 0xD0:  case 0xF0:
+                if(pc != end || static_cast<u16>(pc + 2 + ((byteAt(pc+1) ^ 0x80) - 0x80)) != head)      return 0;
+                ++instructions;
+                if(((pc + 2) ^ head) & 0xFF00)
+                {
+                    if(!stable( (head & 0xFF00) | ((pc + 2) & 0x00FF) ))                                return 0;   // bad page read
+                    return cycles + 4;
+                }
+                return cycles + 3;
+
+            default:
+                return 0;
+            }
+        }
+        return 0;
+    }
+
+    ////////////////////////////////////////////////////
+    //  Stats
+    void Cpu::addStats(RunStats& stats) const
+    {
+        stats.instructions +=       instructionCount;
+        stats.idleLoopSkips +=      idleSkips;
+        stats.idleCyclesSkipped +=  idleCyclesSkipped;
+    }
+
+    void Cpu::clearStats()
+    {
+        instructionCount = 0;
+        idleSkips = 0;
+        idleCyclesSkipped = 0;
+    }
+
+    ////////////////////////////////////////////////////
+    //  Instructions
+    //    'opcode' is either a plain u8 (switch dispatch), or a std::integral_constant when building the
+    //  dispatch table -- in which case each instantiation's switch folds away to just the one case.
+    template <bool Traced, typename Opcode>
+    inline void Cpu::executeOp(Opcode opcode)
+    {
+        switch(opcode)
+        {
+            /* Branches */
+        case 0x10:  adBranch( !cpu.getN() );        break;  /* BPL  */
+        case 0x30:  adBranch(  cpu.getN() );        break;  /* BMI  */
+        case 0x50:  adBranch( !cpu.getV() );        break;  /* BVC  */
+        case 0x70:  adBranch(  cpu.getV() );        break;  /* BVS  */
+        case 0x90:  adBranch( !cpu.getC() );        break;  /* BCC  */
+        case 0xB0:  adBranch(  cpu.getC() );        break;  /* BCS  */
+        case 0xD0:  adBranch( !cpu.getZ() );        break;  /* BNE  */
+        case 0xF0:  adBranch(  cpu.getZ() );        break;  /* BEQ  */
+
+            /* Flag flip-flop   */
+        case 0x18:  adImplied(); cpu.setC(0);       break;  /* CLC  */
+        case 0x38:  adImplied(); cpu.setC(1);       break;  /* SEC  */
+        case 0x58:  adImplied(); cpu.setI(0);       break;  /* CLI  */
+        case 0x78:  adImplied(); cpu.setI(1);       break;  /* SEI  */
+        case 0xB8:  adImplied(); cpu.setV(0);       break;  /* CLV  */
+        case 0xD8:  adImplied(); cpu.setD(0);       break;  /* CLD  */
+        case 0xF8:  adImplied(); cpu.setD(1);       break;  /* SED  */
+
+            /* Stack push/pull  */
+        case 0x08:  adPush( cpu.getStatus(true) );  break;  /* PHP  */
+        case 0x28:  cpu.setStatus( adPull() );      break;  /* PLP  */
+        case 0x48:  adPush( cpu.A );                break;  /* PHA  */
+        case 0x68:  cpu.NZ( cpu.A = adPull() );     break;  /* PLA  */
+
+            /* Reg Xfer         */
+        case 0xAA:  adImplied(); cpu.NZ( cpu.X = cpu.A );   break;  /* TAX  */
+        case 0xA8:  adImplied(); cpu.NZ( cpu.Y = cpu.A );   break;  /* TAY  */
+        case 0xBA:  adImplied(); cpu.NZ( cpu.X = cpu.SP );  break;  /* TSX  */
+        case 0x8A:  adImplied(); cpu.NZ( cpu.A = cpu.X );   break;  /* TXA  */
+        case 0x9A:  adImplied();        cpu.SP = cpu.X;     break;  /* TXS  */
+        case 0x98:  adImplied(); cpu.NZ( cpu.A = cpu.Y );   break;  /* TYA  */
+
+            /* Misc */
+        case 0x00:  performInterrupt<Traced>(true); break;  /* BRK          */
+        case 0x4C:  full_JMP();                     break;  /* JMP $xxxx    */
+        case 0x6C:  full_JMP_Indirect();            break;  /* JMP ($xxxx)  */
+        case 0x20:  full_JSR();                     break;  /* JSR $xxxx    */
+        case 0xEA:  adImplied();                    break;  /* NOP          */
+        case 0x40:  full_RTI();                     break;  /* RTI          */
+        case 0x60:  full_RTS();                     break;  /* RTS          */
+
+            /* ADC  */
+        case 0x69:  ADC( adRdIm() );                break;
+        case 0x65:  ADC( adRdZp() );                break;
+        case 0x75:  ADC( adRdZx() );                break;
+        case 0x6D:  ADC( adRdAb() );                break;
+        case 0x7D:  ADC( adRdAx() );                break;
+        case 0x79:  ADC( adRdAy() );                break;
+        case 0x61:  ADC( adRdIx() );                break;
+        case 0x71:  ADC( adRdIy() );                break;
+            
+            /* AND  */
+        case 0x29:  AND( adRdIm() );                break;
+        case 0x25:  AND( adRdZp() );                break;
+        case 0x35:  AND( adRdZx() );                break;
+        case 0x2D:  AND( adRdAb() );                break;
+        case 0x3D:  AND( adRdAx() );                break;
+        case 0x39:  AND( adRdAy() );                break;
+        case 0x21:  AND( adRdIx() );                break;
+        case 0x31:  AND( adRdIy() );                break;
+
+            /* ASL  */
+        case 0x0A:  adImplied();    ASL(cpu.A);     break;
+        case 0x06:  adRWZp( &Cpu::ASL );            break;
+        case 0x16:  adRWZx( &Cpu::ASL );            break;
+        case 0x0E:  adRWAb( &Cpu::ASL );            break;
+        case 0x1E:  adRWAx( &Cpu::ASL );            break;
+
+            /* BIT  */
+        case 0x24:  BIT( adRdZp() );                break;
+        case 0x2C:  BIT( adRdAb() );                break;
+            
+            /* CMP  */
+        case 0xC9:  CMP( adRdIm() );                break;
+        case 0xC5:  CMP( adRdZp() );                break;
+        case 0xD5:  CMP( adRdZx() );                break;
+        case 0xCD:  CMP( adRdAb() );                break;
+        case 0xDD:  CMP( adRdAx() );                break;
+        case 0xD9:  CMP( adRdAy() );                break;
+        case 0xC1:  CMP( adRdIx() );                break;
+        case 0xD1:  CMP( adRdIy() );                break;
+            
+            /* CPX  */
+        case 0xE0:  CPX( adRdIm() );                break;
+        case 0xE4:  CPX( adRdZp() );                break;
+        case 0xEC:  CPX( adRdAb() );                break;
+            
+            /* CPY  */
+        case 0xC0:  CPY( adRdIm() );                break;
+        case 0xC4:  CPY( adRdZp() );                break;
+        case 0xCC:  CPY( adRdAb() );                break;
+            
+            /* DEC  */
+        case 0xCA:  adImplied();    DEC(cpu.X);     break;  /* DEX  */
+        case 0x88:  adImplied();    DEC(cpu.Y);     break;  /* DEY  */
+        case 0xC6:  adRWZp( &Cpu::DEC );            break;
+        case 0xD6:  adRWZx( &Cpu::DEC );            break;
+        case 0xCE:  adRWAb( &Cpu::DEC );            break;
+        case 0xDE:  adRWAx( &Cpu::DEC );            break;
+            
+            /* EOR  */
+        case 0x49:  EOR( adRdIm() );                break;
+        case 0x45:  EOR( adRdZp() );                break;
+        case 0x55:  EOR( adRdZx() );                break;
+        case 0x4D:  EOR( adRdAb() );                break;
+        case 0x5D:  EOR( adRdAx() );                break;
+        case 0x59:  EOR( adRdAy() );                break;
+        case 0x41:  EOR( adRdIx() );                break;
+        case 0x51:  EOR( adRdIy() );                break;
+            
+            /* INC  */
+        case 0xE8:  adImplied();    INC(cpu.X);     break;  /* INX  */
+        case 0xC8:  adImplied();    INC(cpu.Y);     break;  /* INY  */
+        case 0xE6:  adRWZp( &Cpu::INC );            break;
+        case 0xF6:  adRWZx( &Cpu::INC );            break;
+        case 0xEE:  adRWAb( &Cpu::INC );            break;
+        case 0xFE:  adRWAx( &Cpu::INC );            break;
+            
+            /* LDA  */
+        case 0xA9:  cpu.NZ( cpu.A = adRdIm() );     break;
+        case 0xA5:  cpu.NZ( cpu.A = adRdZp() );     break;
+        case 0xB5:  cpu.NZ( cpu.A = adRdZx() );     break;
+        case 0xAD:  cpu.NZ( cpu.A = adRdAb() );     break;
+        case 0xBD:  cpu.NZ( cpu.A = adRdAx() );     break;
+        case 0xB9:  cpu.NZ( cpu.A = adRdAy() );     break;
+        case 0xA1:  cpu.NZ( cpu.A = adRdIx() );     break;
+        case 0xB1:  cpu.NZ( cpu.A = adRdIy() );     break;
+            
+            /* LDX  */
+        case 0xA2:  cpu.NZ( cpu.X = adRdIm() );     break;
+        case 0xA6:  cpu.NZ( cpu.X = adRdZp() );     break;
+        case 0xB6:  cpu.NZ( cpu.X = adRdZy() );     break;
+        case 0xAE:  cpu.NZ( cpu.X = adRdAb() );     break;
+        case 0xBE:  cpu.NZ( cpu.X = adRdAy() );     break;
+            
+            /* LDY  */
+        case 0xA0:  cpu.NZ( cpu.Y = adRdIm() );     break;
+        case 0xA4:  cpu.NZ( cpu.Y = adRdZp() );     break;
+        case 0xB4:  cpu.NZ( cpu.Y = adRdZx() );     break;
+        case 0xAC:  cpu.NZ( cpu.Y = adRdAb() );     break;
+        case 0xBC:  cpu.NZ( cpu.Y = adRdAx() );     break;
+            
+            /* LSR  */
+        case 0x4A:  adImplied();    LSR(cpu.A);     break;
+        case 0x46:  adRWZp( &Cpu::LSR );            break;
+        case 0x56:  adRWZx( &Cpu::LSR );            break;
+        case 0x4E:  adRWAb( &Cpu::LSR );            break;
+        case 0x5E:  adRWAx( &Cpu::LSR );            break;
+            
+            /* ORA  */
+        case 0x09:  ORA( adRdIm() );                break;
+        case 0x05:  ORA( adRdZp() );                break;
+        case 0x15:  ORA( adRdZx() );                break;
+        case 0x0D:  ORA( adRdAb() );                break;
+        case 0x1D:  ORA( adRdAx() );                break;
+        case 0x19:  ORA( adRdAy() );                break;
+        case 0x01:  ORA( adRdIx() );                break;
+        case 0x11:  ORA( adRdIy() );                break;
+
+            /* ROL  */
+        case 0x2A:  adImplied();    ROL(cpu.A);     break;
+        case 0x26:  adRWZp( &Cpu::ROL );            break;
+        case 0x36:  adRWZx( &Cpu::ROL );            break;
+        case 0x2E:  adRWAb( &Cpu::ROL );            break;
+        case 0x3E:  adRWAx( &Cpu::ROL );            break;
+
+            /* ROR  */
+        case 0x6A:  adImplied();    ROR(cpu.A);     break;
+        case 0x66:  adRWZp( &Cpu::ROR );            break;
+        case 0x76:  adRWZx( &Cpu::ROR );            break;
+        case 0x6E:  adRWAb( &Cpu::ROR );            break;
+        case 0x7E:  adRWAx( &Cpu::ROR );            break;
+            
+            /* SBC  */
+        case 0xE9:  SBC( adRdIm() );                break;
+        case 0xE5:  SBC( adRdZp() );                break;
+        case 0xF5:  SBC( adRdZx() );                break;
+        case 0xED:  SBC( adRdAb() );                break;
+        case 0xFD:  SBC( adRdAx() );                break;
+        case 0xF9:  SBC( adRdAy() );                break;
+        case 0xE1:  SBC( adRdIx() );                break;
+        case 0xF1:  SBC( adRdIy() );                break;
+            
+            /* STA  */
+        case 0x85:  adWrZp( cpu.A );                break;
+        case 0x95:  adWrZx( cpu.A );                break;
+        case 0x8D:  adWrAb( cpu.A );                break;
+        case 0x9D:  adWrAx( cpu.A );                break;
+        case 0x99:  adWrAy( cpu.A );                break;
+        case 0x81:  adWrIx( cpu.A );                break;
+        case 0x91:  adWrIy( cpu.A );                break;
+            
+            /* STX  */
+        case 0x86:  adWrZp( cpu.X );                break;
+        case 0x96:  adWrZy( cpu.X );                break;
+        case 0x8E:  adWrAb( cpu.X );                break;
+            
+            /* STY  */
+        case 0x84:  adWrZp( cpu.Y );                break;
+        case 0x94:  adWrZx( cpu.Y );                break;
+        case 0x8C:  adWrAb( cpu.Y );                break;
+            
+            /////////////////////////////////////
+            // Unofficial ops
+            
+            /* One offs */
+        case 0x0B:
+        case 0x2B:  ANC( adRdIm() );                break;  /* ANC  */
+        case 0x4B:  ALR( adRdIm() );                break;  /* ALR  */
+        case 0x6B:  ARR( adRdIm() );                break;  /* ARR  */
+        case 0xCB:  AXS( adRdIm() );                break;  /* AXS  */
+        case 0xBB:  LAS( adRdAy() );                break;  /* LAS  */
+        case 0xEB:  SBC( adRdIm() );                break;  /* alternative SBC  */
+        case 0x9E:  adWrAy_xxx( cpu.X );            break;  /* SHX  */
+        case 0x9C:  adWrAx_xxx( cpu.Y );            break;  /* SHY  */
+        case 0x8B:  XAA( adRdIm() );                break;  /* XAA  */
+
+        case 0x9B:  cpu.SP = cpu.A & cpu.X; adWrAy_xxx( cpu.SP );     break;  /* TAS  */
+            
+            /* AHX  */
+        case 0x9F:  adWrAy_xxx( cpu.A & cpu.X );    break;
+        case 0x93:  adWrIy_xxx( cpu.A & cpu.X );    break;
+
+            /* DCP  */
+        case 0xC7:  adRWZp( &Cpu::DCP );            break;
+        case 0xD7:  adRWZx( &Cpu::DCP );            break;
+        case 0xCF:  adRWAb( &Cpu::DCP );            break;
+        case 0xDF:  adRWAx( &Cpu::DCP );            break;
+        case 0xDB:  adRWAy( &Cpu::DCP );            break;
+        case 0xC3:  adRWIx( &Cpu::DCP );            break;
+        case 0xD3:  adRWIy( &Cpu::DCP );            break;
+            
+            /* ISC  */
+        case 0xE7:  adRWZp( &Cpu::ISC );            break;
+        case 0xF7:  adRWZx( &Cpu::ISC );            break;
+        case 0xEF:  adRWAb( &Cpu::ISC );            break;
+        case 0xFF:  adRWAx( &Cpu::ISC );            break;
+        case 0xFB:  adRWAy( &Cpu::ISC );            break;
+        case 0xE3:  adRWIx( &Cpu::ISC );            break;
+        case 0xF3:  adRWIy( &Cpu::ISC );            break;
+
+            /* LAX  */
+        case 0xAB:  LAX( adRdIm() );                break;
+        case 0xA7:  LAX( adRdZp() );                break;
+        case 0xB7:  LAX( adRdZy() );                break;
+        case 0xAF:  LAX( adRdAb() );                break;
+        case 0xBF:  LAX( adRdAy() );                break;
+        case 0xA3:  LAX( adRdIx() );                break;
+        case 0xB3:  LAX( adRdIy() );                break;
+
+            /* NOP  */
+        case 0x1A: case 0x3A: case 0x5A: case 0x7A: case 0xDA: case 0xFA:   adImplied();break;
+        case 0x04: case 0x44: case 0x64:                                    adRdZp();   break;
+        case 0x14: case 0x34: case 0x54: case 0x74: case 0xD4: case 0xF4:   adRdZx();   break;
+        case 0x80: case 0x82: case 0x89: case 0xC2: case 0xE2:              adRdIm();   break;
+        case 0x0C:                                                          adRdAb();   break;
+        case 0x1C: case 0x3C: case 0x5C: case 0x7C: case 0xDC: case 0xFC:   adRdAx();   break;
+            
+            /* RLA  */
+        case 0x27:  adRWZp( &Cpu::RLA );            break;
+        case 0x37:  adRWZx( &Cpu::RLA );            break;
+        case 0x2F:  adRWAb( &Cpu::RLA );            break;
+        case 0x3F:  adRWAx( &Cpu::RLA );            break;
+        case 0x3B:  adRWAy( &Cpu::RLA );            break;
+        case 0x23:  adRWIx( &Cpu::RLA );            break;
+        case 0x33:  adRWIy( &Cpu::RLA );            break;
+            
+            /* RRA  */
+        case 0x67:  adRWZp( &Cpu::RRA );            break;
+        case 0x77:  adRWZx( &Cpu::RRA );            break;
+        case 0x6F:  adRWAb( &Cpu::RRA );            break;
+        case 0x7F:  adRWAx( &Cpu::RRA );            break;
+        case 0x7B:  adRWAy( &Cpu::RRA );            break;
+        case 0x63:  adRWIx( &Cpu::RRA );            break;
+        case 0x73:  adRWIy( &Cpu::RRA );            break;
+
+            /* SAX  */
+        case 0x87:  adWrZp( cpu.A & cpu.X );        break;
+        case 0x97:  adWrZy( cpu.A & cpu.X );        break;
+        case 0x8F:  adWrAb( cpu.A & cpu.X );        break;
+        case 0x83:  adWrIx( cpu.A & cpu.X );        break;
+            
+            /* SLO  */
+        case 0x07:  adRWZp( &Cpu::SLO );            break;
+        case 0x17:  adRWZx( &Cpu::SLO );            break;
+        case 0x0F:  adRWAb( &Cpu::SLO );            break;
+        case 0x1F:  adRWAx( &Cpu::SLO );            break;
+        case 0x1B:  adRWAy( &Cpu::SLO );            break;
+        case 0x03:  adRWIx( &Cpu::SLO );            break;
+        case 0x13:  adRWIy( &Cpu::SLO );            break;
+            
+            /* SRE  */
+        case 0x47:  adRWZp( &Cpu::SRE );            break;
+        case 0x57:  adRWZx( &Cpu::SRE );            break;
+        case 0x4F:  adRWAb( &Cpu::SRE );            break;
+        case 0x5F:  adRWAx( &Cpu::SRE );            break;
+        case 0x5B:  adRWAy( &Cpu::SRE );            break;
+        case 0x43:  adRWIx( &Cpu::SRE );            break;
+        case 0x53:  adRWIy( &Cpu::SRE );            break;
+
+            /* STP  */
+        case 0x02: case 0x12: case 0x22: case 0x32: case 0x42: case 0x52:
+        case 0x62: case 0x72: case 0x92: case 0xB2: case 0xD2: case 0xF2:
+            cpuJammed = true;
+            break;
+        }
     }
 
 }
\ No newline at end of file
@@ -2,9 +2,11 @@
 #ifndef SCHPUNE_NESCORE_CPU_H_INCLUDED
 #define SCHPUNE_NESCORE_CPU_H_INCLUDED
 
+#include <utility>
 #include "schpunetypes.h"
 #include "cpustate.h"
 #include "subsystem.h"
+#include "runstats.h"
 
 
 namespace schcore
@@ -27,17 +29,39 @@ namespace schcore
         void                primeNsf(u8 A, u8 X, u16 PC);
         void                unjam()                                     { cpuJammed = false;            }
 
+        //////////////////////////////////////////////////
+        //  Save states
+        void                serialize(StateStream& s);
+
         //////////////////////////////////////////////////
         //  Running
         virtual void        run(timestamp_t runto) override;
 
+        //////////////////////////////////////////////////
+        //  Stats
+        void                addStats(RunStats& stats) const;
+        void                clearStats();
+
     private:
         //////////////////////////////////////////
         //  Interface for CpuBus:  consuming a cycle
         //    CpuBus will call this for every read/write, even those initiated by other
         //  subsystems (DMA unit)
         friend class CpuBus;
-        void                consumeCycle();
+        void                consumeCycle()
+        {
+            if(cpuJammed)       return;
+
+            cyc();
+            if(curCyc() > eventDeadline)    // same test EventManager::check does -- only call out if an event is due
+                runEvents();
+        }
+
+        //////////////////////////////////////////
+        //  Interface for EventManager:  it pushes the time of its next event here whenever
+        //    that changes, so consumeCycle doesn't have to ask every cycle
+        friend class EventManager;
+        void                setEventDeadline(timestamp_t t)             { eventDeadline = t;            }
 
 
     private:
@@ -50,14 +74,56 @@ namespace schcore
         CpuTracer*          tracer;
         CpuBus*             bus;
         EventManager*       eventManager;
+        timestamp_t         eventDeadline = Time::Never;
         CpuState            cpu;
 
+        void                runEvents();
+
         void                pollInterrupt();
         bool                wantInterrupt;
         bool                wantReset;
         bool                cpuJammed;
 
-        void                performInterrupt(bool sw);
+        //  The run loop and interrupt are specialized on whether or not the tracer is on, so an untraced
+        //    run doesn't pay for checking it every instruction.  run() picks one once per call.
+        template <bool Traced> void runLoop(timestamp_t runto);
+        template <bool Traced> void performInterrupt(bool sw);
+        template <bool Traced, typename Opcode> void executeOp(Opcode opcode);
+
+        //////////////////////////////////////////
+        //  Idle loop skipping
+        //    When the PC jumps a short way backwards, the loop it just closed might be one the game is idling in
+        //  (waiting for NMI to set a flag, etc).  If the loop only reads plain memory and it left the CPU in
+        //  exactly the same state as the last time around, every following iteration will be identical until
+        //  an event happens -- so those iterations can be skipped over.
+        static const int    maxIdleLoopBytes = 16;
+        struct IdleLoop
+        {
+            u16             head = 0;               // first instruction of the loop
+            u16             tail = 0;               // the branch/jump back to 'head'
+            timestamp_t     cycles = 0;             // CPU cycles for one time around the loop (0 if it can't be skipped)
+            int             instructions = 0;       // instructions in one time around
+            bool            armed = false;          // true if the below was captured on the previous time around
+            timestamp_t     time;
+            timestamp_t     deadline;
+            u8              regs[5];                // A, X, Y, SP, status
+        };
+        IdleLoop            idleLoop;
+        u64                 instructionCount = 0;
+        u64                 idleSkips = 0;
+        u64                 idleCyclesSkipped = 0;
+
+        void                checkIdleLoop(u16 tail, timestamp_t runto);
+        timestamp_t         idleLoopCycles(u16 head, u16 tail, int& instructions) const;
+
+        //  Build with SCHPUNE_CPU_TABLE_DISPATCH to dispatch instructions through a 256-entry table of
+        //    handlers instead of one big switch
+#ifdef SCHPUNE_CPU_TABLE_DISPATCH
+        typedef void (*OpHandler)(Cpu&);
+        template <bool Traced, u8 Op> static void tableOp(Cpu& c);
+        template <bool Traced, std::size_t... Ops>
+        static const OpHandler* opTable(std::index_sequence<Ops...>);
+#endif
 
         typedef     void (Cpu::*rmw_op)(u8&);
 
@@ -3,6 +3,7 @@
 #include "resetinfo.h"
 #include <stdexcept>
 #include "cpu.h"
+#include "dmaunit.h"
 
 namespace schcore
 {
@@ -28,47 +29,60 @@ namespace schcore
                     peekers[i][j] = pkproc_t();
                 }
             }
+            for(auto& i : directRead)   i = nullptr;
+            for(auto& i : directWrite)  i = nullptr;
 
             // reset lines
             aLine = 0;
             dLine = 0;
             wLine = false;
             cpu = info.cpu;
+            dmaUnit = info.dmaUnit;
+            dmaPending = false;
+            oddCycle = false;
 
             // reset register IRQs
             irqNames.clear();
         }
     }
 
+    void CpuBus::serialize(StateStream& s)
+    {
+        s(dmaPending);
+        s(oddCycle);
+        s(aLine);
+        s(dLine);
+        s(wLine);
+        s.as<u32>(pendingIrq);
+        s(pendingNmi);
+    }
+
     ///////////////////////////////
     //  Memory accessing
-    u8 CpuBus::read(u16 a)
+    //    read/write themselves are inline (in cpubus.h).  These are the slow paths
+    void CpuBus::runDma(u16 a)
     {
-        cpu->consumeCycle();
+        dmaUnit->onRead(a);
+    }
 
+    u8 CpuBus::readProcs(u16 a)
+    {
         u8 v = dLine;
         for(auto& proc : readers[a>>12])
         {
             if(!proc)       break;
             proc(a, v);
         }
-        wLine = false;
-        aLine = a;
-        return dLine = v;
+        return v;
     }
 
-    void CpuBus::write(u16 a, u8 v)
+    void CpuBus::writeProcs(u16 a, u8 v)
     {
-        cpu->consumeCycle();
-
         for(auto& proc : writers[a>>12])
         {
             if(!proc)       break;
             proc(a, v);
         }
-        wLine = true;
-        aLine = a;
-        dLine = v;
     }
 
     int CpuBus::peek(int a) const
@@ -150,8 +164,44 @@ namespace schcore
         }
     }
     
-    void CpuBus::addReader(int pagefirst, int pagelast, const rdproc_t& proc)   {   addProc(pagefirst, pagelast, proc, readers);    }
-    void CpuBus::addWriter(int pagefirst, int pagelast, const wrproc_t& proc)   {   addProc(pagefirst, pagelast, proc, writers);    }
+    void CpuBus::addReader(int pagefirst, int pagelast, const rdproc_t& proc)
+    {
+        addProc(pagefirst, pagelast, proc, readers);
+        if(pagefirst < 0)           return;
+
+        // direct access is only possible if there's just the one proc
+        for(int i = (pagefirst << 4); i < ((pagelast+1) << 4); ++i)
+        {
+            if(readers[i>>4][1])    directRead[i] = nullptr;
+        }
+    }
+
+    void CpuBus::addWriter(int pagefirst, int pagelast, const wrproc_t& proc)
+    {
+        addProc(pagefirst, pagelast, proc, writers);
+        if(pagefirst < 0)           return;
+
+        // direct access is only possible if there's just the one proc
+        for(int i = (pagefirst << 4); i < ((pagelast+1) << 4); ++i)
+        {
+            if(writers[i>>4][1])    directWrite[i] = nullptr;
+        }
+    }
+
     void CpuBus::addPeeker(int pagefirst, int pagelast, const pkproc_t& proc)   {   addProc(pagefirst, pagelast, proc, peekers);    }
+    
+    //////////////////////////////////////////////////
+    //  Direct memory pages
+    void CpuBus::setDirectRead(u16 a, const u8* mem)
+    {
+        const auto& procs = readers[a>>12];
+        directRead[a>>8] = (procs[0] && !procs[1]) ? mem : nullptr;
+    }
+
+    void CpuBus::setDirectWrite(u16 a, u8* mem)
+    {
+        const auto& procs = writers[a>>12];
+        directWrite[a>>8] = (procs[0] && !procs[1]) ? mem : nullptr;
+    }
 
 }
\ No newline at end of file
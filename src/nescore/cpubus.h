@@ -3,15 +3,17 @@
 #define SCHPUNE_NESCORE_CPUBUS_H_INCLUDED
 
 #include <string>
-#include <functional>
 #include <vector>
 #include "schpunetypes.h"
+#include "delegate.h"
+#include "cpu.h"
 
 
 namespace schcore
 {
     class ResetInfo;
     class Cpu;
+    class DmaUnit;
 
     class CpuBus
     {
@@ -19,16 +21,19 @@ namespace schcore
         //////////////////////////////////////////////////
         //  Resetting
         void                reset(const ResetInfo& info);
+        void                serialize(StateStream& s);      // procs and direct pages are left alone -- they only change on hard reset
 
 
         //////////////////////////////////////////////////
         //  Callback handler types
-        typedef std::function<void(u16,u8&)>    rdproc_t;
-        typedef std::function<void(u16,u8 )>    wrproc_t;
-        typedef std::function<int (u16    )>    pkproc_t;
+        typedef Delegate<void(u16,u8&)>         rdproc_t;
+        typedef Delegate<void(u16,u8 )>         wrproc_t;
+        typedef Delegate<int (u16    )>         pkproc_t;
 
         //////////////////////////////////////////////////
         //  Primary interfacing with the bus
+        //    read/write are inline so accesses to direct memory pages (see below) -- which is most instruction
+        //  fetches and RAM accesses -- don't cost a call.
         u8                  read(u16 a);
         void                write(u16 a, u8 v);
         int                 peek(int a) const;  // 'peek' is effectively a consequence-free read (no side-effects).
@@ -65,13 +70,42 @@ namespace schcore
         void                addWriter(int pagefirst, int pagelast, const wrproc_t& proc);
         void                addPeeker(int pagefirst, int pagelast, const pkproc_t& proc);
 
-        // simplified template interface
-        template <typename C> void  addReader(int pagefirst, int pagelast, C* obj, void (C::*proc)(u16,u8&))
-            { addReader(pagefirst, pagelast, std::bind(proc, obj, std::placeholders::_1, std::placeholders::_2) );      }
-        template <typename C> void  addWriter(int pagefirst, int pagelast, C* obj, void (C::*proc)(u16,u8 ))
-            { addWriter(pagefirst, pagelast, std::bind(proc, obj, std::placeholders::_1, std::placeholders::_2) );      }
-        template <typename C> void  addPeeker(int pagefirst, int pagelast, const C* obj, int (C::*proc)(u16) const)
-            { addPeeker(pagefirst, pagelast, std::bind(proc, obj, std::placeholders::_1) );                             }
+        // simplified template interface:  addReader<Foo, &Foo::onRead>(0x8, 0xF, this);
+        template <typename C, void (C::*proc)(u16,u8&)>     void addReader(int pagefirst, int pagelast, C* obj)
+            { addReader(pagefirst, pagelast, rdproc_t::bind<C, proc>(obj) );    }
+        template <typename C, void (C::*proc)(u16,u8 )>     void addWriter(int pagefirst, int pagelast, C* obj)
+            { addWriter(pagefirst, pagelast, wrproc_t::bind<C, proc>(obj) );    }
+        template <typename C, int (C::*proc)(u16) const>    void addPeeker(int pagefirst, int pagelast, const C* obj)
+            { addPeeker(pagefirst, pagelast, pkproc_t::bind<C, proc>(obj) );    }
+
+
+        //////////////////////////////////////////////////
+        //  Direct memory pages
+        //    Areas that are just plain memory (system RAM, PRG) don't need to go through the proc lists.
+        //  Whoever owns the 4K page can give the bus a pointer to the 256 bytes backing the 256-byte page
+        //  containing 'a', and the bus will access that memory directly instead of calling procs.
+        //    This is only honored if there is exactly one proc on that 4K page (it's assumed to be the owner's
+        //  proc).  If any other proc gets added to the page, its direct pointers are dropped.
+        //    Pass nullptr to go back to using the procs (ie:  memory is unmapped / not readable / not writable).
+        void                setDirectRead(u16 a, const u8* mem);
+        void                setDirectWrite(u16 a, u8* mem);
+
+
+        //////////////////////////////////////////////////
+        //  DMA
+        //    The DMA unit hijacks the next read cycle when it wants the bus.  Rather than sitting in every
+        //  page's read proc list, it just tells the bus when it has something pending.
+        void                setDmaPending(bool pending)     { dmaPending = pending;     }
+        bool                isDmaPending() const            { return dmaPending;        }
+        bool                isOddCycle() const              { return oddCycle;          }   // parity of the number of accesses so far
+
+        //////////////////////////////////////////////////
+        //  Idle loop skipping (see Cpu)
+        //    getDirectRead gives a pointer to the byte at 'a' if it's on a direct read page (and therefore plain
+        //  memory which can be read with no side effects), or nullptr if not.  skipCycles accounts for
+        //  'cycles' accesses which the CPU fast-forwarded through instead of performing.
+        const u8*           getDirectRead(u16 a) const      { auto mem = directRead[a>>8]; return mem ? (mem + (a & 0xFF)) : nullptr;  }
+        void                skipCycles(timestamp_t cycles)  { if(cycles & 1) oddCycle = !oddCycle;    }
 
     private:
         static const int            maxProcs = 6;
@@ -79,7 +113,17 @@ namespace schcore
         wrproc_t                    writers[0x10][maxProcs];
         pkproc_t                    peekers[0x10][maxProcs];
 
+        const u8*                   directRead[0x100];  // per 256-byte page, nullptr if procs must be used
+        u8*                         directWrite[0x100];
+
+        void                        runDma(u16 a);
+        u8                          readProcs(u16 a);
+        void                        writeProcs(u16 a, u8 v);
+
         Cpu*                        cpu;                // access to CPU for consuming cycles
+        DmaUnit*                    dmaUnit;
+        bool                        dmaPending;
+        bool                        oddCycle;
 
         u16                         aLine;
         u8                          dLine;
@@ -92,6 +136,41 @@ namespace schcore
         std::vector<std::string>    irqNames;
     };
 
+    //////////////////////////////////////////////////
+    //  Memory accessing
+    inline u8 CpuBus::read(u16 a)
+    {
+        cpu->consumeCycle();
+        if(dmaPending)
+            runDma(a);
+
+        u8 v;
+        if(auto mem = directRead[a>>8])
+            v = mem[a & 0xFF];
+        else
+            v = readProcs(a);
+
+        oddCycle = !oddCycle;
+        wLine = false;
+        aLine = a;
+        return dLine = v;
+    }
+
+    inline void CpuBus::write(u16 a, u8 v)
+    {
+        cpu->consumeCycle();
+
+        if(auto mem = directWrite[a>>8])
+            mem[a & 0xFF] = v;
+        else
+            writeProcs(a, v);
+
+        oddCycle = !oddCycle;
+        wLine = true;
+        aLine = a;
+        dLine = v;
+    }
+
 
 }
 
@@ -3,6 +3,7 @@
 #define SCHPUNE_NESCORE_CPUSTATE_H_INCLUDED
 
 #include "schpunetypes.h"
+#include "statestream.h"
 
 
 namespace schcore
@@ -37,6 +38,12 @@ namespace schcore
         // sets N/Z appropriately given a byte (ex: $80 sets N and clears Z)
         void        NZ(u8 v)        { fNZ = v;                      }
 
+        void        serialize(StateStream& s)
+        {
+            s(A);   s(X);   s(Y);   s(SP);  s(PC);
+            s(fNZ); s(fC);  s(fI);  s(fD);  s(fV);
+        }
+
     private:
         static const u8             C_FLAG = 0x01;
         static const u8             Z_FLAG = 0x02;
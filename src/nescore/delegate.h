@@ -0,0 +1,50 @@
+#ifndef SCHPUNE_NESCORE_DELEGATE_H_INCLUDED
+#define SCHPUNE_NESCORE_DELEGATE_H_INCLUDED
+
+namespace schcore
+{
+    //////////////////////////////////////////////////
+    //  Delegate
+    //    A bound member function call:  an object pointer, plus a thunk which calls a specific member function
+    //  on it.  The member function is a template parameter, so the thunk is a direct (inlinable) call -- the
+    //  only indirection is the call through the thunk pointer itself.
+    //
+    //    This replaces std::bind into a std::function for the bus procs.  It never allocates, is trivially
+    //  copyable, and is only two pointers big.
+    //
+    //      auto d = Delegate<void(u16,u8&)>::bind<Nes, &Nes::onReadRam>(this);
+
+    template <typename Sig> class Delegate;
+
+    template <typename R, typename... Args>
+    class Delegate<R(Args...)>
+    {
+    public:
+        Delegate() = default;
+
+        template <typename C, R (C::*proc)(Args...)>
+        static Delegate bind(C* obj)                { return Delegate( obj, &callMember<C, proc> );                        }
+
+        template <typename C, R (C::*proc)(Args...) const>
+        static Delegate bind(const C* obj)          { return Delegate( const_cast<C*>(obj), &callConstMember<C, proc> );   }
+
+        explicit operator bool () const             { return thunk != nullptr;          }
+        R        operator () (Args... args) const   { return thunk(object, args...);    }
+
+    private:
+        typedef R (*thunk_t)(void*, Args...);
+
+        void*                   object = nullptr;
+        thunk_t                 thunk = nullptr;
+
+        Delegate(void* obj, thunk_t t) : object(obj), thunk(t) {}
+
+        template <typename C, R (C::*proc)(Args...)>
+        static R callMember(void* obj, Args... args)        { return (static_cast<C*>(obj)->*proc)(args...);        }
+
+        template <typename C, R (C::*proc)(Args...) const>
+        static R callConstMember(void* obj, Args... args)   { return (static_cast<const C*>(obj)->*proc)(args...);  }
+    };
+}
+
+#endif
@@ -2,6 +2,7 @@
 #include "dmaunit.h"
 #include "cpubus.h"
 #include "resetinfo.h"
+#include "statestream.h"
 
 namespace schcore
 {
@@ -16,15 +17,30 @@ namespace schcore
             bus = info.cpuBus;
             wantDmc = false;
             hasDmcVal = false;
-            oddCycle = false;
 
             oamPage = 0;
             dmcAddr = 0;
             dmcVal = 0;
             
-            bus->addReader(0x0, 0xF, this, &DmaUnit::onRead);
-            bus->addWriter(0x0, 0xF, this, &DmaUnit::onWrite);
+            bus->addWriter<DmaUnit, &DmaUnit::onWrite>(0x4, 0x4, this);
         }
+        syncPending();
+    }
+
+    void DmaUnit::serialize(StateStream& s)
+    {
+        s(wantOam);
+        s(wantDmc);
+        s(midDma);
+        s(hasDmcVal);
+        s(oamPage);
+        s(dmcAddr);
+        s(dmcVal);
+    }
+
+    void DmaUnit::syncPending()
+    {
+        bus->setDmaPending(wantOam || wantDmc);
     }
 
     
@@ -32,6 +48,7 @@ namespace schcore
     {
         wantDmc = true;
         dmcAddr = addr;
+        syncPending();
     }
 
     void DmaUnit::getFetchedByte(u8& byte, bool& hasval)
@@ -42,15 +59,15 @@ namespace schcore
     }
 
     
-    void DmaUnit::onRead(u16 a, u8& v)
+    void DmaUnit::onRead(u16 a)
     {
         if(!midDma && (wantDmc || wantOam))
         {
             midDma = true;  // prevent re-entrant
             performDma(a);
             midDma = false;
+            syncPending();
         }
-        oddCycle = !oddCycle;
     }
 
     void DmaUnit::onWrite(u16 a, u8 v)
@@ -59,17 +76,17 @@ namespace schcore
         {
             wantOam = true;
             oamPage = (v << 8);
+            syncPending();
         }
-        oddCycle = !oddCycle;
     }
 
     void DmaUnit::performDma(u16 dummyaddr)
     {
         if(wantDmc && !wantOam)         // DMC-only is nice and easy
         {
-            bus->read(dummyaddr);                   // dummy for the halt
-            bus->read(dummyaddr);                   // extra dummy for DMC-only
-            if(oddCycle)    bus->read(dummyaddr);   // dummy for alignment
+            bus->read(dummyaddr);                               // dummy for the halt
+            bus->read(dummyaddr);                               // extra dummy for DMC-only
+            if(bus->isOddCycle())   bus->read(dummyaddr);       // dummy for alignment
 
             hasDmcVal = true;
             wantDmc = false;
@@ -93,7 +110,7 @@ namespace schcore
         bus->read(dummyaddr);
 
         // do we need alignment for OAM?
-        if(oddCycle)
+        if(bus->isOddCycle())
         {
             hadpad = hadhalt;
             hadhalt = wantDmc;
@@ -137,8 +154,8 @@ namespace schcore
             if(hadhalt)
             {
                 // had halt, but not pad -- add the padding
-                bus->read(dummyaddr);                   // padding
-                if(oddCycle) bus->read(dummyaddr);      // realignment if necessary
+                bus->read(dummyaddr);                               // padding
+                if(bus->isOddCycle())   bus->read(dummyaddr);       // realignment if necessary
                 hasDmcVal = true;
                 dmcVal = bus->read(dmcAddr);
             }
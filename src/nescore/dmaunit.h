@@ -10,11 +10,13 @@ namespace schcore
 {
     class ResetInfo;
     class CpuBus;
+    class StateStream;
 
     class DmaUnit : public DmcSupplier
     {
     public:
         void                reset(const ResetInfo& info);
+        void                serialize(StateStream& s);
 
         // DmcSupplier stuff
         virtual bool        willBeAudible() const override                  { return hasDmcVal;        }
@@ -28,16 +30,17 @@ namespace schcore
         bool                wantDmc;
         bool                midDma;
         bool                hasDmcVal;
-        bool                oddCycle;
 
         u16                 oamPage;
         u16                 dmcAddr;
         u8                  dmcVal;
 
-        void                onRead(u16 a, u8& v);
+        friend class        CpuBus;             // the bus calls onRead directly when DMA is pending
+        void                onRead(u16 a);
         void                onWrite(u16 a, u8 v);
 
         void                performDma(u16 dummyaddr);
+        void                syncPending();
         
     };
 }
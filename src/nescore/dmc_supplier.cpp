@@ -1,6 +1,7 @@
 #include "cpubus.h"
 #include "resetinfo.h"
 #include "dmc_supplier.h"
+#include "statestream.h"
 
 
 namespace schcore
@@ -14,6 +15,12 @@ namespace schcore
             bus = info.cpuBus;
     }
 
+    void Dmc_PeekSampleBuffer::serialize(StateStream& s)
+    {
+        s(val);
+        s(hasVal);
+    }
+
     void Dmc_PeekSampleBuffer::triggerFetch(u16 addr)
     {
         hasVal = true;
@@ -28,10 +28,12 @@ namespace schcore
     //  This is the audible DMC supplier
     class CpuBus;
     class ResetInfo;
+    class StateStream;
     class Dmc_PeekSampleBuffer : public DmcSupplier
     {
     public:
         void            reset(const ResetInfo& info);
+        void            serialize(StateStream& s);
         
         virtual bool    willBeAudible() const override                  { return hasVal;        }
         virtual void    triggerFetch(u16 addr) override;
@@ -1,4 +1,3 @@
-
 #include "eventmanager.h"
 #include "subsystem.h"
 #include "resetinfo.h"
@@ -6,6 +5,10 @@
 #include "ppu.h"
 #include "cputracer.h"
 #include "cartridge.h"
+#include "cpu.h"
+#include "cpubus.h"
+#include "statestream.h"
+#include <stdexcept>
 
 namespace schcore
 {
@@ -14,29 +17,64 @@ namespace schcore
     {
         if(info.hardReset)
         {
+            cpu =           info.cpu;
+            cpuBus =        info.cpuBus;
             apu =           info.apu;
             ppu =           info.ppu;
             mpr =           info.cartridge;
 
-            events.clear();
-            nextEvent = Time::Never;
+            eventCount = 0;
+            epoch = 0;
+            setNextEvent( Time::Never );
+            clearStats();
+        }
+    }
+
+    void EventManager::serialize(StateStream& s)
+    {
+        // handles are all created on hard reset, so the same game always has the same ones
+        int count = eventCount;
+        s(count);
+        if(count != eventCount)
+            throw Error("Save state does not match the loaded game (event handles differ)");
+
+        s(epoch);
+        for(int i = 0; i < eventCount; ++i)
+        {
+            s(events[i].when);
+            s(events[i].active);
         }
+
+        if(s.isLoading())
+            recalcNextEvent();
     }
 
     void EventManager::subtractFromTimestamps(timestamp_t sub)
     {
-        if(events.empty())
-            return;
+        epoch += sub;
+        if(nextEvent != Time::Never)
+            setNextEvent( nextEvent - sub );
+    }
 
-        decltype(events)    newevents;
+    void EventManager::setNextEvent(timestamp_t t)
+    {
+        nextEvent = t;
+        cpu->setEventDeadline(t);
+    }
 
-        for(auto& i : events)
+    void EventManager::recalcNextEvent()
+    {
+        s64 next = 0;
+        bool any = false;
+        for(int i = 0; i < eventCount; ++i)
         {
-            newevents[i.first - sub] = i.second;
+            if(events[i].active && (!any || events[i].when < next))
+            {
+                next = events[i].when;
+                any = true;
+            }
         }
-
-        events = std::move(newevents);
-        nextEvent -= sub;
+        setNextEvent( any ? static_cast<timestamp_t>(next - epoch) : Time::Never );
     }
 
     void EventManager::check(timestamp_t checktime)
@@ -47,33 +85,88 @@ namespace schcore
         //  next one, but hasn't yet happened.
         if(checktime > nextEvent)
         {
-            nextEvent = Time::Never;
-
-            auto i = events.begin();
+            s64 due = checktime + epoch;
             int toupdate = 0;
-            while(i != events.end())
+            for(int i = 0; i < eventCount; ++i)
             {
-                if(i->first >= checktime)
+                if(events[i].active && events[i].when < due)
                 {
-                    nextEvent = i->first;
-                    break;
+                    events[i].active = false;
+                    toupdate |= events[i].type;
                 }
-                toupdate |= i->second;
-                i = events.erase(i);
             }
+            recalcNextEvent();
+
+            // a wakeup is "spurious" if running the subsystems didn't raise anything the CPU will notice
+            bool nmi = cpuBus->isNmiPending();
+            auto irq = cpuBus->isIrqPending();
+            bool dma = cpuBus->isDmaPending();
             
             if(toupdate & EventType::evt_apu)   apu->run(checktime);
             if(toupdate & EventType::evt_ppu)   ppu->run(checktime);
             if(toupdate & EventType::evt_mpr)   mpr->run(checktime);
+
+            ++wakeups;
+            if(    (nmi || !cpuBus->isNmiPending())
+                && !(cpuBus->isIrqPending() & ~irq)
+                && (dma || !cpuBus->isDmaPending()) )
+                ++spuriousWakeups;
         }
     }
 
-    void EventManager::addEvent(timestamp_t time, EventType subsystem)
+    auto EventManager::createHandle(EventType subsystem) -> handle_t
     {
-        if(!subsystem)                  return;
+        if(eventCount >= maxEvents)
+            throw std::runtime_error("Internal error:  Too many event handles created");
 
-        if(time < nextEvent)            nextEvent = time;
-        events[time] |= subsystem;
+        events[eventCount].when = 0;
+        events[eventCount].type = subsystem;
+        events[eventCount].active = false;
+        return eventCount++;
+    }
+
+    void EventManager::setEvent(handle_t handle, timestamp_t time)
+    {
+        if(time == Time::Never)
+        {
+            cancelEvent(handle);
+            return;
+        }
+
+        auto& e = events[handle];
+        if(e.active)
+            ++cancels;
+
+        e.when = time + epoch;
+        e.active = true;
+        if(time < nextEvent)            setNextEvent( time );
+        else                            recalcNextEvent();
+    }
+
+    void EventManager::cancelEvent(handle_t handle)
+    {
+        auto& e = events[handle];
+        if(!e.active)                   return;
+
+        ++cancels;
+        e.active = false;
+        recalcNextEvent();
+    }
+    
+    //////////////////////////////////////////////////
+    //  Stats
+    void EventManager::addStats(RunStats& stats) const
+    {
+        stats.eventWakeups +=       wakeups;
+        stats.spuriousWakeups +=    spuriousWakeups;
+        stats.eventsCancelled +=    cancels;
+    }
+
+    void EventManager::clearStats()
+    {
+        wakeups = 0;
+        spuriousWakeups = 0;
+        cancels = 0;
     }
 
-}
\ No newline at end of file
+}
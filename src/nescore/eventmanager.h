@@ -1,9 +1,8 @@
-
 #ifndef SCHPUNE_NESCORE_EVENTMANAGER_H_INCLUDED
 #define SCHPUNE_NESCORE_EVENTMANAGER_H_INCLUDED
 
-#include <map>
 #include "schpunetypes.h"
+#include "runstats.h"
 
 namespace schcore
 {
@@ -17,27 +16,69 @@ namespace schcore
     class ResetInfo;
     class SubSystem;
     class CpuTracer;
+    class CpuBus;
+    class Cpu;
+    class StateStream;
 
 
     class EventManager
     {
     public:
+        //////////////////////////////////////////////////
+        //  Event handles
+        //    Each thing that predicts events gets its own handle (on hard reset, after the event manager has been
+        //  reset).  A handle holds at most one pending event:  setting it again replaces the old prediction, so
+        //  stale predictions never cause a wakeup.  Predictors should cancel their handle when they know
+        //  nothing is coming (setting an event at Time::Never does the same thing).
+        typedef int     handle_t;
+
         void            reset(const ResetInfo& info);
+        void            serialize(StateStream& s);
 
         void            subtractFromTimestamps(timestamp_t sub);
         void            check(timestamp_t checktime);
 
-        void            addEvent(timestamp_t time, EventType subsystem);
+        handle_t        createHandle(EventType subsystem);
+        void            setEvent(handle_t handle, timestamp_t time);
+        void            cancelEvent(handle_t handle);
+
+        //////////////////////////////////////////////////
+        //  Stats
+        void            addStats(RunStats& stats) const;
+        void            clearStats();
 
     private:
+        //////////////////////////////////////////////////
+        //  Events are stored relative to 'epoch' (the total amount that has been subtracted from
+        //    timestamps since the hard reset).  That way rebasing at the end of a frame is just adjusting 'epoch'.
+        //    These are 64-bit so the epoch doesn't wrap.
+        struct Event
+        {
+            s64         when;
+            EventType   type;
+            bool        active;
+        };
+        static const int            maxEvents = 8;
+        Event                       events[maxEvents];
+        int                         eventCount;
+        s64                         epoch;
+
+        Cpu*                        cpu;        // gets told about nextEvent, so it knows when to call check()
+        CpuBus*                     cpuBus;     // for spotting spurious wakeups
         SubSystem*                  apu;
         SubSystem*                  ppu;
         SubSystem*                  mpr;
-        std::map<timestamp_t, int>  events;
         timestamp_t                 nextEvent;
+
+        u64                         wakeups;
+        u64                         spuriousWakeups;
+        u64                         cancels;
+
+        void                        setNextEvent(timestamp_t t);
+        void                        recalcNextEvent();
     };
 
 
 }
 
-#endif
\ No newline at end of file
+#endif
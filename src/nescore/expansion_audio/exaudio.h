@@ -17,6 +17,7 @@ namespace schcore
     public:
         virtual ~ExAudio() = default;
         virtual void reset(const ResetInfo& info) = 0;
+        virtual void serialize(StateStream& s)                      { subSystem_Serialize(s);   }   // derived classes should call this too
 
         // Stuff only needed for things which have a master clock (MMC5's frame sequencer, VRC7's AM/FM)
         virtual timestamp_t audMaster_clocksToNextUpdate()          { return Time::Never;  }
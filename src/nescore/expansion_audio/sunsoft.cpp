@@ -21,10 +21,18 @@ namespace schcore
             addChannel( ChannelId::sunsoft_chan1, &chans[1] );
             addChannel( ChannelId::sunsoft_chan2, &chans[2] );
             
-            info.cpuBus->addWriter(0xC, 0xF, this, &SunsoftAudio::onWrite);
+            info.cpuBus->addWriter<SunsoftAudio, &SunsoftAudio::onWrite>(0xC, 0xF, this);
         }
     }
 
+    void SunsoftAudio::serialize(StateStream& s)
+    {
+        ExAudio::serialize(s);
+        s(addr);
+        for(auto& c : chans)
+            c.serialize(s);
+    }
+
     void SunsoftAudio::onWrite(u16 a, u8 v)
     {
         if((a & 0xE000) == 0xC000)
@@ -64,6 +72,16 @@ namespace schcore
         dutyPhase       = 0;
     }
 
+    void SunsoftAudio::Tone::serialize(StateStream& s)
+    {
+        channelSerialize(s);
+        s(freqTimer);
+        s(volume);
+        s(enabled);
+        s(freqCounter);
+        s(dutyPhase);
+    }
+
     int SunsoftAudio::Tone::doTicks(timestamp_t ticks, bool doaudio, bool docpu)
     {
         if(!doaudio)    return false;
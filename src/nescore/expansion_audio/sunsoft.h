@@ -16,6 +16,7 @@ namespace schcore
     public:
                         SunsoftAudio() {}
         virtual void    reset(const ResetInfo& info) override;
+        virtual void    serialize(StateStream& s) override;
         
 
     private:
@@ -28,6 +29,7 @@ namespace schcore
 
             virtual void            makeSilent() override   { enabled = false;  }
             void                    hardReset();
+            void                    serialize(StateStream& s);
 
         protected:
             //  To be implemented by derived classes
@@ -23,7 +23,7 @@ namespace schcore
             addChannel( ChannelId::vrc6_pulse1, &pulse[1] );
             addChannel( ChannelId::vrc6_saw, &saw );
 
-            info.cpuBus->addWriter( 0x9, 0xB, this, &Vrc6Audio::onWrite );
+            info.cpuBus->addWriter<Vrc6Audio, &Vrc6Audio::onWrite>( 0x9, 0xB, this );
         }
         else
         {
@@ -34,6 +34,14 @@ namespace schcore
         }
     }
 
+    void Vrc6Audio::serialize(StateStream& s)
+    {
+        ExAudio::serialize(s);
+        pulse[0].serialize(s);
+        pulse[1].serialize(s);
+        saw.serialize(s);
+    }
+
     void Vrc6Audio::onWrite(u16 a, u8 v)
     {
         if(swapLines)
@@ -125,6 +133,7 @@ namespace schcore
     }
     void Vrc6Audio::Pulse::hardReset()
     {
+        channelHardReset();
         mainDisable = false;
         freqShifter = 0;
         volume = 0;
@@ -133,6 +142,18 @@ namespace schcore
         dutyPhase = dutyMode = 0;
         enabled = false;
     }
+    void Vrc6Audio::Pulse::serialize(StateStream& s)
+    {
+        channelSerialize(s);
+        s(mainDisable);
+        s(freqShifter);
+        s(volume);
+        s(freqCounter);
+        s(freqTimer);
+        s(dutyPhase);
+        s(dutyMode);
+        s(enabled);
+    }
     
     //////////////////////////////////////////
     //////////////////////////////////////////
@@ -209,6 +230,7 @@ namespace schcore
     }
     void Vrc6Audio::Sawtooth::hardReset()
     {
+        channelHardReset();
         mainDisable = false;
         freqShifter = 0;
         freqCounter = 0;
@@ -218,5 +240,17 @@ namespace schcore
         accumulator = 0;
         enabled = false;
     }
+    void Vrc6Audio::Sawtooth::serialize(StateStream& s)
+    {
+        channelSerialize(s);
+        s(mainDisable);
+        s(freqShifter);
+        s(freqCounter);
+        s(freqTimer);
+        s(phase);
+        s(accAdd);
+        s(accumulator);
+        s(enabled);
+    }
 
 }
\ No newline at end of file
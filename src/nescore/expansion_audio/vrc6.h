@@ -14,6 +14,7 @@ namespace schcore
     public:
                         Vrc6Audio(bool swap_lines) : swapLines(swap_lines) {}
         virtual void    reset(const ResetInfo& info) override;
+        virtual void    serialize(StateStream& s) override;
         
 
     private:
@@ -24,6 +25,7 @@ namespace schcore
             void                    write(u16 a, u8 v);
             void                    writeMaster(u8 v);
             void                    hardReset();
+            void                    serialize(StateStream& s);
 
         protected:
             //  To be implemented by derived classes
@@ -50,6 +52,7 @@ namespace schcore
             void                    write(u16 a, u8 v);
             void                    writeMaster(u8 v);
             void                    hardReset();
+            void                    serialize(StateStream& s);
 
         protected:
             //  To be implemented by derived classes
@@ -4,7 +4,6 @@
 #include "../cpubus.h"
 #include <cmath>
 #include <algorithm>
-#include <memory>
 
 namespace schcore
 {
@@ -21,14 +20,13 @@ namespace schcore
     //  Construction and reset
     Vrc7Audio::Vrc7Audio()
     {
-        buildAllLuts();
     }
 
     void Vrc7Audio::reset(const ResetInfo& info)
     {
         if(info.hardReset)
         {
-            setClockBase( info.region.apuClockBase * 36 );  // TODO - load VRC7 clock from region
+            subSystem_HardReset( info.apu, info.region.apuClockBase * 36 );     // TODO - load VRC7 clock from region
             info.apu->addExAudioMaster(this);
 
             setApuObj(info.apu);
@@ -36,6 +34,7 @@ namespace schcore
 
             for(auto& c : ch)
             {
+                c.channelHardReset();
                 c.fNum =                0;
                 c.block =               0;
                 c.feedbackLevel =       0;
@@ -75,7 +74,7 @@ namespace schcore
             for(auto& i : customInstData)       i = 0;
             vrc7Addr = 0;
 
-            info.cpuBus->addWriter(0x9, 0x9, this, &Vrc7Audio::onWrite );
+            info.cpuBus->addWriter<Vrc7Audio, &Vrc7Audio::onWrite>(0x9, 0x9, this );
         }
         else
         {
@@ -83,6 +82,52 @@ namespace schcore
         }
     }
     
+    ////////////////////////////////////////////////////
+    //  Save states
+    void Vrc7Audio::serialize(StateStream& s)
+    {
+        ExAudio::serialize(s);
+        for(auto& c : ch)
+            c.serialize(s);
+        s(customInstData);
+        s(vrc7Addr);
+    }
+
+    void Vrc7Audio::Channel::serialize(StateStream& s)
+    {
+        channelSerialize(s);
+        s(fNum);
+        s(block);
+        s(feedbackLevel);
+        s(instId);
+        s(inst);
+        s(slowRelease);
+
+        for(auto& sl : slot)
+        {
+            s.as<u8>(sl.adsr);
+            s(sl.rawOut);
+            s(sl.output);
+            s(sl.phase);
+            s(sl.phaseAdd);
+            s(sl.multi);
+            s(sl.baseAtten);
+            s(sl.kslAtten);
+            s(sl.egc);
+            s(sl.rateAttack);
+            s(sl.rateDecay);
+            s(sl.rateSustain);
+            s(sl.rateRelease);
+            s(sl.sustainLevel);
+            s(sl.kslBits);
+            s(sl.rectify);
+            s(sl.amEnabled);
+            s(sl.fmEnabled);
+            s(sl.percussive);
+            s(sl.useKsr);
+        }
+    }
+    
     ////////////////////////////////////////////////////
     ////////////////////////////////////////////////////
     //  Misc stuff
@@ -14,6 +14,7 @@ namespace schcore
     public:
                         Vrc7Audio();
         virtual void    reset(const ResetInfo& info) override;
+        virtual void    serialize(StateStream& s) override;
         
     protected:
         timestamp_t     audMaster_clocksToNextUpdate() override;
@@ -78,6 +79,7 @@ namespace schcore
             
             void                    keyOn();
             void                    keyOff();
+            void                    serialize(StateStream& s);
 
         protected:
             virtual int             doTicks(timestamp_t ticks, bool doaudio, bool docpu) override;
@@ -5,8 +5,6 @@
 namespace
 {
 
-    typedef std::unique_ptr<int[]>      lut_t;
-    bool                                lutsBuilt = false;
     const double                        pi = 3.1415926535897932384626433832795;
     
 
@@ -58,13 +56,9 @@ namespace
     const int           linLutSize =            (1<<linLutBitWidth);
     const int           linLutShift =           (egcBitWidth - linLutBitWidth);
     const int           linLutMask =            (linLutSize-1);
-    lut_t               linLut;
 
-    inline int      lut_linear(int x)           { return linLut[ (x >> linLutShift) & linLutMask ]; }
-    void            buildLut_Linear()
+    void            buildLut_Linear(int* linLut)
     {
-        linLut = lut_t( new int[linLutSize] );
-
         for(int i = 0; i < linLutSize; ++i)
         {
             linLut[i] = static_cast<int>( maxSlotOutput * dbToLinear( static_cast<double>(i) / (linLutSize-1) ) );
@@ -84,12 +78,9 @@ namespace
     const int           sinLutSize =            (1<<sinLutBitWidth);
     const int           sinLutShift =           (phaseBitWidth - 1 - sinLutBitWidth);       // -1 because we want to drop the high bit
     const int           sinLutMask =            sinLutSize-1;
-    lut_t               sinLut;
-    inline int      lut_sine(int x)             { return sinLut[ (x >> sinLutShift) & sinLutMask ]; }
-    void            buildLut_Sine()
-    {
-        sinLut = lut_t( new int[sinLutSize] );
 
+    void            buildLut_Sine(int* sinLut)
+    {
         for(int i = 0; i < sinLutSize; ++i)
         {
             sinLut[i] = static_cast<int>( maxAttenuation * linearToDb( std::sin( pi * i / sinLutSize ) ) );
@@ -105,11 +96,9 @@ namespace
     const int           atkLutSize =            (1<<atkLutBitWidth);
     const int           atkLutShift =           (egcBitWidth - atkLutBitWidth);
     const int           atkLutMask =            atkLutSize-1;
-    lut_t               atkLut;
-    inline int      lut_attack(int x)           { return atkLut[ (x >> atkLutShift) & atkLutMask ]; }
-    void            buildLut_Attack()
+
+    void            buildLut_Attack(int* atkLut)
     {
-        atkLut = lut_t( new int[atkLutSize] );
         double mxlog = std::log(atkLutSize-1);
 
         for(int i = 0; i < atkLutSize; ++i)
@@ -122,16 +111,26 @@ namespace
 
     ////////////////////////////////
     //  do all of them!
-    void buildAllLuts()
+    //    They're built once, when the program starts, and never change after that -- so every Vrc7Audio, on
+    //  whatever thread, just reads the same ones.
+    struct Luts
     {
-        if(lutsBuilt)       return;
-        
-        buildLut_Linear();
-        buildLut_Sine();
-        buildLut_Attack();
+        int     linear[linLutSize];
+        int     sine[sinLutSize];
+        int     attack[atkLutSize];
 
-        lutsBuilt = true;
-    }
+        Luts()
+        {
+            buildLut_Linear(linear);
+            buildLut_Sine(sine);
+            buildLut_Attack(attack);
+        }
+    };
+    const Luts          luts;
+
+    inline int      lut_linear(int x)           { return luts.linear[ (x >> linLutShift) & linLutMask ];   }
+    inline int      lut_sine(int x)             { return luts.sine  [ (x >> sinLutShift) & sinLutMask ];   }
+    inline int      lut_attack(int x)           { return luts.attack[ (x >> atkLutShift) & atkLutMask ];   }
 
 
     ////////////////////////////////
@@ -1,5 +1,6 @@
 
 #include "inputdevice.h"
+#include "statestream.h"
 
 namespace schcore
 {
@@ -31,6 +32,13 @@ namespace schcore
             strobe_bit = newstrobe;
         }
 
+        void Controller::serialize(StateStream& s)
+        {
+            // 'state' is the buttons being held right now -- that's input, not state
+            s(latch);
+            s(strobe_bit);
+        }
+
         u8 Controller::read()
         {
             if(strobe_bit)      return (state & 0x01);
@@ -16,12 +16,19 @@ namespace schcore{ namespace mpr {
                 tempReg = 0;
                 nextBit = 0x01;
 
-                cpuBus->addWriter(0x8,0xF,this,&Mpr_001::onWrite);
+                cpuBus->addWriter<Mpr_001, &Mpr_001::onWrite>(0x8,0xF,this);
             }
             
             syncAll();
         }
 
+        virtual void cartSerialize(StateStream& s) override
+        {
+            s(regs);
+            s(tempReg);
+            s(nextBit);
+        }
+
     private:
         u8      regs[4];
         u8      tempReg;
@@ -14,10 +14,15 @@ namespace schcore{ namespace mpr {
                 swapChr_8k(0,0);
                 syncPrg();
 
-                cpuBus->addWriter(0x8,0xF,this,&Mpr_002::onWrite);
+                cpuBus->addWriter<Mpr_002, &Mpr_002::onWrite>(0x8,0xF,this);
             }
         }
 
+        virtual void cartSerialize(StateStream& s) override
+        {
+            s(page);
+        }
+
     private:
         u8      page;
         void onWrite(u16 a, u8 v)
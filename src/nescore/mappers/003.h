@@ -12,10 +12,15 @@ namespace schcore{ namespace mpr {
                 swapChr_8k(0,0);
                 page = 0;
 
-                info.cpuBus->addWriter(0x8,0xF,this,&Mpr_003::onWrite);
+                info.cpuBus->addWriter<Mpr_003, &Mpr_003::onWrite>(0x8,0xF,this);
             }
         }
 
+        virtual void cartSerialize(StateStream& s) override
+        {
+            s(page);
+        }
+
     private:
         u8      page;
         void onWrite(u16 a, u8 v)
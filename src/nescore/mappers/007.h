@@ -14,10 +14,15 @@ namespace schcore{ namespace mpr {
                 swapChr_8k(0,0);
                 syncAll();
 
-                info.cpuBus->addWriter(0x8,0xF,this,&Mpr_007::onWrite);
+                info.cpuBus->addWriter<Mpr_007, &Mpr_007::onWrite>(0x8,0xF,this);
             }
         }
 
+        virtual void cartSerialize(StateStream& s) override
+        {
+            s(reg);
+        }
+
     private:
         u8      reg;
         void onWrite(u16 a, u8 v)
@@ -16,12 +16,19 @@ namespace schcore{ namespace mpr {
                 prg = 0;
                 mir = 0;
 
-                info.cpuBus->addWriter(0xA,0xF,this,&Mpr_009::onWrite);
+                info.cpuBus->addWriter<Mpr_009, &Mpr_009::onWrite>(0xA,0xF,this);
             }
             
             syncAll();
         }
 
+        virtual void cartSerialize(StateStream& s) override
+        {
+            Mmc2Latch::cartSerialize(s);
+            s(prg);
+            s(mir);
+        }
+
     private:
         u8      prg;
         u8      mir;
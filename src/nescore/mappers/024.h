@@ -24,11 +24,21 @@ namespace schcore{ namespace mpr {
                 mode = 0;
                 syncAll();
                 
-                info.cpuBus->addWriter(0x8,0x8,this,&Mpr_024::onWrite);
-                info.cpuBus->addWriter(0xB,0xF,this,&Mpr_024::onWrite);
+                info.cpuBus->addWriter<Mpr_024, &Mpr_024::onWrite>(0x8,0x8,this);
+                info.cpuBus->addWriter<Mpr_024, &Mpr_024::onWrite>(0xB,0xF,this);
             }
         }
 
+        virtual void cartSerialize(StateStream& s) override
+        {
+            VrcIrq_Mapper::cartSerialize(s);
+            audio->serialize(s);
+            s(chr);
+            s(bigprg);
+            s(smlprg);
+            s(mode);
+        }
+
     private:
         bool                        swapLines;
         std::unique_ptr<Vrc6Audio>  audio;
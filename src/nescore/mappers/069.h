@@ -14,6 +14,7 @@ namespace schcore{ namespace mpr {
                 setDefaultPrgCallbacks();
 
                 evt = info.eventManager;
+                irqEvent = evt->createHandle(EventType::evt_mpr);
 
                 addr = 0;
                 for(auto& i : chrRegs)      i = 0;
@@ -27,10 +28,22 @@ namespace schcore{ namespace mpr {
                 swapPrg_8k( 0xE, ~0 );
                 syncAll();
 
-                cpuBus->addWriter(0x8, 0xB, this, &Mpr_069::onWrite);
+                cpuBus->addWriter<Mpr_069, &Mpr_069::onWrite>(0x8, 0xB, this);
             }
         }
 
+        virtual void cartSerialize(StateStream& s) override
+        {
+            audio->serialize(s);
+            s(addr);
+            s(chrRegs);
+            s(prgRegs);
+            s(ntReg);
+            s(irqCtrl);
+            s(irqCounter);
+            s(irqPending);
+        }
+
     private:
         std::unique_ptr<SunsoftAudio>  audio = std::make_unique<SunsoftAudio>();
         u8              addr;
@@ -42,6 +55,7 @@ namespace schcore{ namespace mpr {
         irqsource_t     irqBit;
         bool            irqPending;
         EventManager*   evt;
+        EventManager::handle_t  irqEvent;
 
         void onWrite(u16 a, u8 v)
         {
@@ -137,13 +151,16 @@ namespace schcore{ namespace mpr {
         void predict()
         {
             if((irqCtrl & 0x81) != 0x81)
+            {
+                evt->cancelEvent(irqEvent);
                 return;
+            }
 
             timestamp_t ticks = irqCounter;
 
             ticks *= getClockBase();
             ticks += curCyc();
-            evt->addEvent(ticks, EventType::evt_mpr);
+            evt->setEvent(irqEvent, ticks);
         }
 
         virtual void run(timestamp_t runto) override
@@ -23,10 +23,19 @@ namespace schcore{ namespace mpr {
                 mode = 0;
                 syncAll();
                 
-                info.cpuBus->addWriter(0x8,0xF,this,&Mpr_085::onWrite);
+                info.cpuBus->addWriter<Mpr_085, &Mpr_085::onWrite>(0x8,0xF,this);
             }
         }
 
+        virtual void cartSerialize(StateStream& s) override
+        {
+            VrcIrq_Mapper::cartSerialize(s);
+            audio->serialize(s);
+            s(prg);
+            s(chr);
+            s(mode);
+        }
+
     private:
         std::unique_ptr<Vrc7Audio>  audio;            // TODO
         u8                          prg[3];
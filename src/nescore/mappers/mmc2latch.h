@@ -17,6 +17,15 @@ namespace schcore{ namespace mpr {
             }
         }
 
+        virtual void cartSerialize(StateStream& s) override
+        {
+            s.bytes(chr, sizeof(chr));
+            s(latches);
+            s(lastAccess);
+        }
+
+        virtual bool cartWatchesChrReads() const override   { return true;      }   // the latches flip on them
+
         void setChrReg(int lohi, int latchval, u8 v)
         {
             chr[lohi][latchval] = v;
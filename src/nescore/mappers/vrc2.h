@@ -27,10 +27,17 @@ namespace schcore{ namespace mpr {
 
                 syncAll();
                 
-                info.cpuBus->addWriter(0x8,0xE,this,&Vrc2::onWrite);
+                info.cpuBus->addWriter<Vrc2, &Vrc2::onWrite>(0x8,0xE,this);
             }
         }
 
+        virtual void cartSerialize(StateStream& s) override
+        {
+            s(chr);
+            s(prg);
+            s(mir);
+        }
+
     private:
         std::vector<u16>            bitLines[2];
 
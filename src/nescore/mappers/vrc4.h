@@ -29,10 +29,19 @@ namespace schcore{ namespace mpr {
 
                 syncAll();
                 
-                info.cpuBus->addWriter(0x8,0xF,this,&Vrc4::onWrite);
+                info.cpuBus->addWriter<Vrc4, &Vrc4::onWrite>(0x8,0xF,this);
             }
         }
 
+        virtual void cartSerialize(StateStream& s) override
+        {
+            VrcIrq_Mapper::cartSerialize(s);
+            s(chr);
+            s(prg);
+            s(mir);
+            s(prgMode);
+        }
+
     private:
         std::vector<u16>            bitLines[2];
 
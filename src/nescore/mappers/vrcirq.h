@@ -14,6 +14,7 @@ namespace schcore{ namespace mpr {
             if(info.hardReset)
             {
                 evt = info.eventManager;
+                irqEvent = evt->createHandle(EventType::evt_mpr);
                 irqBit = cpuBus->createIrqCode("Mapper");
 
                 latch = 0xFF;
@@ -24,6 +25,15 @@ namespace schcore{ namespace mpr {
             }
         }
 
+        virtual void cartSerialize(StateStream& s) override
+        {
+            s(latch);
+            s(control);
+            s(pending);
+            s.time(prescalar);
+            s(counter);
+        }
+
         void    writeIrqLatch(u8 v)         { catchUp();    latch = v;                                  }
         void    writeIrqLatch_lo(u8 v)      { catchUp();    latch = (latch & 0xF0) | (v & 0x0F);        }
         void    writeIrqLatch_hi(u8 v)      { catchUp();    latch = (latch & 0x0F) | ((v & 0x0F) << 4); }
@@ -85,6 +95,7 @@ namespace schcore{ namespace mpr {
         irqsource_t     irqBit;
         bool            pending;
         EventManager*   evt;
+        EventManager::handle_t  irqEvent;
 
         timestamp_t     prescalar;
         u8              counter;
@@ -103,8 +114,11 @@ namespace schcore{ namespace mpr {
 
         void predict()
         {
-            if(pending)             return; // nothing to predict if it's already pending
-            if(!(control & 0x02))   return; // nothing to predict if IRQs are disabled
+            if(pending || !(control & 0x02))    // nothing to predict if it's already pending, or if IRQs are disabled
+            {
+                evt->cancelEvent(irqEvent);
+                return;
+            }
 
             timestamp_t ticks;
             if(control & 0x04)
@@ -124,7 +138,7 @@ namespace schcore{ namespace mpr {
 
             ticks *= getClockBase();
             ticks += curCyc();
-            evt->addEvent(ticks, EventType::evt_mpr);
+            evt->setEvent(irqEvent, ticks);
         }
 
     };
@@ -0,0 +1,7 @@
+#include "memorychip.h"
+
+namespace schcore
+{
+    const bool ChipPage::alwaysTrue  = true;
+    const bool ChipPage::alwaysFalse = false;
+}
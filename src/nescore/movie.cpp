@@ -0,0 +1,289 @@
+
+#include <algorithm>
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include "movie.h"
+#include "nes.h"
+#include "error.h"
+
+namespace schcore
+{
+    namespace
+    {
+        const u32       movieMagic =        0x4D484353;     // "SCHM"
+        const u32       movieVersion =      1;
+
+        ////////////////////////////////////////
+        //  Hashing
+        //    Speed matters more than quality here -- this is run over ~125K of data every frame.  8 bytes at a time
+        //  in 4 independent lanes, so the multiplies can overlap.
+
+        const u64       hashPrime =         0x100000001B3ULL;
+
+        inline u64 mix(u64 h)
+        {
+            h ^= h >> 33;   h *= 0xFF51AFD7ED558CCDULL;
+            h ^= h >> 33;   h *= 0xC4CEB9FE1A85EC53ULL;
+            h ^= h >> 33;
+            return h;
+        }
+
+        u64 hashBytes(const void* data, std::size_t size, u64 seed)
+        {
+            auto p = static_cast<const u8*>(data);
+            u64 lane[4] = { seed, seed ^ 1, seed ^ 2, seed ^ 3 };
+            u64 w[4];
+
+            for(; size >= 32; size -= 32, p += 32)
+            {
+                std::memcpy(w, p, 32);
+                lane[0] = (lane[0] ^ w[0]) * hashPrime;
+                lane[1] = (lane[1] ^ w[1]) * hashPrime;
+                lane[2] = (lane[2] ^ w[2]) * hashPrime;
+                lane[3] = (lane[3] ^ w[3]) * hashPrime;
+            }
+            for(; size > 0; --size, ++p)
+                lane[0] = (lane[0] ^ *p) * hashPrime;
+
+            return mix( lane[0] ^ mix(lane[1]) ^ mix(mix(lane[2])) ^ mix(mix(mix(lane[3]))) );
+        }
+
+        ////////////////////////////////////////
+        //  File io -- everything little endian
+        void put(std::ostream& file, u64 v, int bytes)
+        {
+            char buf[8];
+            for(int i = 0; i < bytes; ++i)
+                buf[i] = static_cast<char>(v >> (i*8));
+            file.write(buf, bytes);
+        }
+
+        u64 get(std::istream& file, int bytes)
+        {
+            u8 buf[8];
+            if(!file.read(reinterpret_cast<char*>(buf), bytes))
+                throw Error("Movie::load: Unexpected end of file");
+
+            u64 v = 0;
+            for(int i = 0; i < bytes; ++i)
+                v |= static_cast<u64>(buf[i]) << (i*8);
+            return v;
+        }
+    }
+
+    Movie::Movie(Nes& n, input::Controller* port0, input::Controller* port1)
+        : nes(n)
+    {
+        ports[0] = port0;
+        ports[1] = port1;
+    }
+
+    ///////////////////////////////////////////////////////
+    //  Starting / stopping
+    void Movie::startRecording()
+    {
+        frames.clear();
+        audio.clear();
+        curFrame = 0;
+        desyncFrame = -1;
+        pendingCommand = Command::None;
+
+        nes.hardReset();
+        startTrack = static_cast<u8>(nes.nsf_getTrack());
+        mode = Mode::Recording;
+    }
+
+    void Movie::startPlayback()
+    {
+        audio.clear();
+        curFrame = 0;
+        desyncFrame = -1;
+        pendingCommand = Command::None;
+
+        if(nes.isNsf())     nes.nsf_setTrack(startTrack);       // hard resets go back to the current track
+        nes.hardReset();
+        mode = Mode::Playing;
+    }
+
+    void Movie::stop()
+    {
+        mode = Mode::Idle;
+    }
+
+    ///////////////////////////////////////////////////////
+    //  Commands
+    void Movie::doCommand(Command cmd, u8 track)
+    {
+        switch(cmd)
+        {
+        case Command::SoftReset:    nes.softReset();            break;
+        case Command::HardReset:    nes.hardReset();            break;
+        case Command::SetTrack:     nes.nsf_setTrack(track);    break;
+        default:                                                break;
+        }
+    }
+
+    void Movie::softReset()
+    {
+        if(mode == Mode::Recording)     pendingCommand = Command::SoftReset;
+        else if(mode == Mode::Idle)     nes.softReset();
+    }
+
+    void Movie::hardReset()
+    {
+        if(mode == Mode::Recording)     pendingCommand = Command::HardReset;
+        else if(mode == Mode::Idle)     nes.hardReset();
+    }
+
+    void Movie::nsf_setTrack(int track)
+    {
+        if(mode == Mode::Recording)
+        {
+            pendingCommand = Command::SetTrack;
+            pendingTrack = static_cast<u8>(track);
+        }
+        else if(mode == Mode::Idle)
+            nes.nsf_setTrack(track);
+    }
+
+    ///////////////////////////////////////////////////////
+    //  Running
+    void Movie::doFrame()
+    {
+        Frame f;
+        if(mode == Mode::Playing)
+        {
+            if(curFrame >= getFrameCount())
+                mode = Mode::Idle;          // ran out of movie -- let the user take over
+            else
+            {
+                f = frames[curFrame];
+                for(int i = 0; i < 2; ++i)
+                {
+                    if(ports[i])    ports[i]->setState(f.buttons[i], false);
+                }
+                doCommand(f.command, f.track);
+            }
+        }
+        else if(mode == Mode::Recording)
+        {
+            for(int i = 0; i < 2; ++i)
+                f.buttons[i] = static_cast<u8>( ports[i] ? ports[i]->getState() : 0 );
+            f.command = pendingCommand;
+            f.track = pendingTrack;
+            pendingCommand = Command::None;
+            doCommand(f.command, f.track);
+        }
+
+        nes.doFrame();
+
+        // pull out all the audio this frame made, so it can be hashed
+        auto prevsize = audio.size();
+        audio.resize( prevsize + nes.getAvailableAudioSize() );
+        auto got = nes.getAudio( audio.data() + prevsize, static_cast<int>(audio.size() - prevsize), nullptr, 0 );
+        audio.resize( prevsize + got );
+
+        if(mode == Mode::Idle)
+            return;
+
+        u64 hash = hashBytes( audio.data() + prevsize, got, hashFrame() );
+        if(mode == Mode::Recording)
+        {
+            f.hash = hash;
+            frames.push_back(f);
+        }
+        else if(hash != f.hash && desyncFrame < 0)
+            desyncFrame = curFrame;
+
+        ++curFrame;
+    }
+
+    u64 Movie::hashFrame()
+    {
+        u64 hash = hashBytes( nes.getSystemRam(), 0x0800, 0 );
+        if(!nes.isNsf())
+        {
+            // the video is hashed in whatever format it's being drawn in (there might be a video target)
+            int pitch;
+            VideoFormat format;
+            auto mem = static_cast<const u8*>( nes.getVideoOutput(pitch, format) );
+            const bool wide = (format == VideoFormat::RGBA8888 || format == VideoFormat::BGRA8888);
+            const std::size_t rowsize = Nes::videoWidth * (wide ? 4 : 2);
+
+            if(pitch == static_cast<int>(rowsize))
+                hash = hashBytes( mem, rowsize * Nes::videoHeight, hash );
+            else
+            {
+                for(int y = 0; y < Nes::videoHeight; ++y)
+                    hash = hashBytes( mem + y * static_cast<std::ptrdiff_t>(pitch), rowsize, hash );
+            }
+        }
+        return hash;
+    }
+
+    int Movie::getAudio(void* bufa, int siza, void* bufb, int sizb)
+    {
+        int avail = getAvailableAudioSize();
+
+        siza = std::max(0, std::min(siza, avail));
+        if(siza)    std::memcpy(bufa, audio.data(), siza);
+        avail -= siza;
+
+        sizb = std::max(0, std::min(sizb, avail));
+        if(sizb)    std::memcpy(bufb, audio.data() + siza, sizb);
+
+        audio.erase( audio.begin(), audio.begin() + siza + sizb );
+        return siza + sizb;
+    }
+
+    ///////////////////////////////////////////////////////
+    //  Files
+    void Movie::save(std::ostream& file) const
+    {
+        put(file, movieMagic, 4);
+        put(file, movieVersion, 4);
+        put(file, frames.size(), 4);
+        put(file, startTrack, 1);
+
+        for(auto& f : frames)
+        {
+            put(file, f.buttons[0], 1);
+            put(file, f.buttons[1], 1);
+            put(file, static_cast<u8>(f.command), 1);
+            put(file, f.track, 1);
+            put(file, f.hash, 8);
+        }
+    }
+
+    void Movie::load(std::istream& file)
+    {
+        if(get(file, 4) != movieMagic)      throw Error("Movie::load: File is not a movie");
+        if(get(file, 4) != movieVersion)    throw Error("Movie::load: Movie is from a different version");
+
+        auto count = get(file, 4);
+        u8 track = static_cast<u8>(get(file, 1));
+
+        std::vector<Frame> out;
+        out.reserve( static_cast<std::size_t>(std::min<u64>(count, 60*60*60)) );     // (don't trust the count too much)
+        for(u64 i = 0; i < count; ++i)
+        {
+            out.emplace_back();
+            auto& f = out.back();
+            f.buttons[0] =  static_cast<u8>(get(file, 1));
+            f.buttons[1] =  static_cast<u8>(get(file, 1));
+            f.command =     static_cast<Command>(get(file, 1));
+            f.track =       static_cast<u8>(get(file, 1));
+            f.hash =        get(file, 8);
+
+            if(f.command > Command::SetTrack)
+                throw Error("Movie::load: Movie is corrupt");
+        }
+
+        stop();
+        frames = std::move(out);
+        startTrack = track;
+        curFrame = 0;
+        desyncFrame = -1;
+    }
+}
@@ -1,4 +1,5 @@
 
+#include <algorithm>
 #include "nes.h"
 #include "cpu.h"
 #include "cpubus.h"
@@ -11,12 +12,37 @@
 #include "audiobuilder.h"
 #include "nsfdriver.h"
 #include "cputracer.h"
+#include "statestream.h"
 #include "mappers/mappers.h"
 
 
 //////////////////////////////////////////////////////////////
 namespace schcore
 {
+    namespace
+    {
+        // FNV-1a over all the ROM, so save states can only go back into the game they came from
+        u32 hashFile(const NesFile& file)
+        {
+            u32 hash = 2166136261u;
+            for(auto chips : { &file.prgRomChips, &file.chrRomChips })
+            {
+                for(auto& chip : *chips)
+                {
+                    if(!chip.getSize())     continue;
+                    auto dat = chip.getData();
+                    for(std::size_t i = 0; i < chip.getSize(); ++i)
+                        hash = (hash ^ dat[i]) * 16777619u;
+                }
+            }
+            return hash;
+        }
+
+        const u32           stateMagic =        0x53484353;     // "SCHS"
+        const u32           stateVersion =      1;              // bump whenever any serialize() changes
+        const std::size_t   stateHeaderSize =   20;             // 5 u32s
+    }
+
     Nes::Nes()
         : resetInfo( new ResetInfo )
         , cpu( new Cpu )
@@ -66,6 +92,12 @@ namespace schcore
     }
 
     void Nes::loadFile(NesFile&& file)
+    {
+        u32 hash = hashFile(file);
+        loadFile(std::move(file), hash);
+    }
+
+    void Nes::loadFile(NesFile&& file, u32 hash)
     {
         // is the file even loaded?
         if(file.fileType == NesFile::FileType::None)    throw Error("Nes::loadFile: File provided was empty");
@@ -95,6 +127,7 @@ namespace schcore
 
         resetInfo->cartridge = cartridge;
         loadedFile = std::move(file);
+        fileHash = hash;
         cartridge->load(loadedFile);
         fillResetInfo();
         hardReset();
@@ -136,13 +169,14 @@ namespace schcore
         if(!isFileLoaded())     return;
 
         resetInfo->hardReset = hard;
+        if(hard)
+            frameStart = 0;
 
         // reset the busses first
         cpuBus->reset( *resetInfo );
         ppuBus->reset( *resetInfo );
 
-        // DMA unit next, as it needs to add its callbacks to the cpu bus first so that it can
-        //   hijack reads
+        // DMA unit next, as it needs to add its $4014 callback to the cpu bus first
         dmaUnit->reset( *resetInfo );
 
         // Event manager should be next, so subsystems can add their events
@@ -170,13 +204,18 @@ namespace schcore
         //  Add system memory read/writers
         if(hard)
         {
-            cpuBus->addReader( 0, 1, this, &Nes::onReadRam );
-            cpuBus->addWriter( 0, 1, this, &Nes::onWriteRam );
-            cpuBus->addPeeker( 0, 1, this, &Nes::onPeekRam );
+            cpuBus->addReader<Nes, &Nes::onReadRam>( 0, 1, this );
+            cpuBus->addWriter<Nes, &Nes::onWriteRam>( 0, 1, this );
+            cpuBus->addPeeker<Nes, &Nes::onPeekRam>( 0, 1, this );
+            for(int i = 0; i < 0x2000; i += 0x100)
+            {
+                cpuBus->setDirectRead(  static_cast<u16>(i), &systemRam[i & 0x07FF] );
+                cpuBus->setDirectWrite( static_cast<u16>(i), &systemRam[i & 0x07FF] );
+            }
             if(!isNsf())                    // add controller access for non-nsfs
             {
-                cpuBus->addReader( 4, 4, this, &Nes::onReadInput );
-                cpuBus->addWriter( 4, 4, this, &Nes::onWriteInput );
+                cpuBus->addReader<Nes, &Nes::onReadInput>( 4, 4, this );
+                cpuBus->addWriter<Nes, &Nes::onWriteInput>( 4, 4, this );
                 
                 if(inputDevices[0]) inputDevices[0]->hardReset();
                 if(inputDevices[1]) inputDevices[1]->hardReset();
@@ -213,9 +252,208 @@ namespace schcore
         apu->setAudioSettings(stgs);
     }
 
+    RunStats Nes::getRunStats() const
+    {
+        RunStats out;
+        if(isFileLoaded())
+        {
+            eventManager->addStats(out);
+            cpu->addStats(out);
+        }
+        return out;
+    }
+
+    void Nes::clearRunStats()
+    {
+        if(isFileLoaded())
+        {
+            eventManager->clearStats();
+            cpu->clearStats();
+        }
+    }
+
+    ///////////////////////////////////////////////////////
+    //  Save states
+    void Nes::serializeStateHeader(StateStream& s, u32& size)
+    {
+        const u32 ourflags =    (monotonicTimeline ? 1 : 0) | (isNsf() ? 2 : 0)
+                            |   (inputDevices[0] ? 4 : 0)   | (inputDevices[1] ? 8 : 0);
+        u32 magic =     stateMagic;
+        u32 version =   stateVersion;
+        u32 hash =      fileHash;
+        u32 flags =     ourflags;
+
+        s(magic);
+        s(version);
+        s(size);
+        s(hash);
+        s(flags);
+
+        if(s.isLoading())
+        {
+            if(magic != stateMagic)         throw Error("Nes::loadState: Data is not a save state");
+            if(version != stateVersion)     throw Error("Nes::loadState: Save state is from a different version");
+            if(hash != fileHash)            throw Error("Nes::loadState: Save state is for a different game");
+            if(flags != ourflags)           throw Error("Nes::loadState: Save state was made with a different build or different input devices");
+        }
+    }
+
+    void Nes::serializeState(StateStream& s, bool devices)
+    {
+        s.time(frameStart);
+        s(curNsfTrack);
+        s.bytes(systemRam.get(), 0x0800);
+
+        cpu->serialize(s);
+        cpuBus->serialize(s);
+        dmaUnit->serialize(s);
+        ppu->serialize(s);
+        apu->serialize(s);
+        cartridge->serialize(s);
+        audioBuilder->serialize(s);
+        eventManager->serialize(s);     // after the CPU, since this gives it its event deadline
+
+        if(!devices)
+            return;
+        for(auto dev : inputDevices)
+        {
+            if(dev)     dev->serialize(s);
+        }
+    }
+
+    std::size_t Nes::getStateSize()
+    {
+        if(!isFileLoaded())     return 0;
+
+        StateStream s( StateStream::Mode::Measure, nullptr, 0 );
+        serializeState(s);
+        return stateHeaderSize + s.getSize();
+    }
+
+    std::size_t Nes::saveState(void* buffer, std::size_t size)
+    {
+        if(!isFileLoaded())             throw Error("Nes::saveState: No file loaded");
+        if(size < stateHeaderSize)      throw Error("Save state buffer is too small");
+
+        auto buf = static_cast<u8*>(buffer);
+        StateStream body( StateStream::Mode::Save, buf + stateHeaderSize, size - stateHeaderSize );
+        serializeState(body);
+
+        u32 total = static_cast<u32>(stateHeaderSize + body.getSize());
+        StateStream header( StateStream::Mode::Save, buf, stateHeaderSize );
+        serializeStateHeader(header, total);
+
+        return total;
+    }
+
+    void Nes::loadState(const void* buffer, std::size_t size)
+    {
+        if(!isFileLoaded())             throw Error("Nes::loadState: No file loaded");
+
+        // StateStream never writes to the buffer when loading
+        auto buf = const_cast<u8*>( static_cast<const u8*>(buffer) );
+
+        u32 total = 0;
+        StateStream header( StateStream::Mode::Load, buf, size );
+        serializeStateHeader(header, total);
+        if(total < stateHeaderSize || total > size)
+            throw Error("Nes::loadState: Save state data is truncated");
+
+        try
+        {
+            StateStream body( StateStream::Mode::Load, buf + stateHeaderSize, total - stateHeaderSize );
+            serializeState(body);
+            if(body.getSize() != total - stateHeaderSize)
+                throw Error("Nes::loadState: Save state is corrupt (wrong size)");
+        }
+        catch(...)
+        {
+            hardReset();
+            throw;
+        }
+    }
+
+    ///////////////////////////////////////////////////////
+    //  Cloning
+    void Nes::copyStateFrom(const Nes& other)
+    {
+        if(&other == this)              return;
+        if(!other.isFileLoaded())       throw Error("Nes::copyStateFrom: The Nes being copied has no file loaded");
+        for(int i = 0; i < 2; ++i)
+        {
+            if(!inputDevices[i] != !other.inputDevices[i])
+                throw Error("Nes::copyStateFrom: Both have to have the same input ports connected");
+        }
+
+        // Saving never changes anything, so this is safe even with other threads copying from it too
+        auto& src = const_cast<Nes&>(other);
+        StateStream measure( StateStream::Mode::Measure, nullptr, 0 );
+        src.serializeState(measure, false);
+        copyState.resize( measure.getSize() );
+
+        StateStream save( StateStream::Mode::Save, copyState.data(), copyState.size() );
+        src.serializeState(save, false);
+
+        // Our devices might be other's too (clone shares them), so unplug them while loading -- otherwise
+        //  a hard reset would reset them out from under it
+        input::InputDevice* devices[2] = { inputDevices[0], inputDevices[1] };
+        inputDevices[0] = inputDevices[1] = nullptr;
+        try
+        {
+            if(!isFileLoaded() || fileHash != other.fileHash || isNsf() != other.isNsf())
+                loadFile( NesFile(other.loadedFile), other.fileHash );     // (no need to hash it all again)
+
+            StateStream load( StateStream::Mode::Load, copyState.data(), copyState.size() );
+            serializeState(load, false);
+        }
+        catch(...)
+        {
+            if(isFileLoaded())
+                hardReset();
+            inputDevices[0] = devices[0];
+            inputDevices[1] = devices[1];
+            throw;
+        }
+        inputDevices[0] = devices[0];
+        inputDevices[1] = devices[1];
+
+        // A device we both use is already in the right state.  Only copy the ones that are ours alone
+        for(int i = 0; i < 2; ++i)
+        {
+            if(inputDevices[i] == other.inputDevices[i])
+                continue;
+
+            StateStream dmeasure( StateStream::Mode::Measure, nullptr, 0 );
+            other.inputDevices[i]->serialize(dmeasure);
+            copyState.resize( dmeasure.getSize() );
+
+            StateStream dsave( StateStream::Mode::Save, copyState.data(), copyState.size() );
+            other.inputDevices[i]->serialize(dsave);
+            StateStream dload( StateStream::Mode::Load, copyState.data(), copyState.size() );
+            inputDevices[i]->serialize(dload);
+        }
+    }
+
+    std::unique_ptr<Nes> Nes::clone() const
+    {
+        std::unique_ptr<Nes> out( new Nes );
+        out->setAudioSettings( getAudioSettings() );
+        out->setRunAhead( runAheadFrames );
+        out->setChrCacheEnabled( isChrCacheEnabled() );
+
+        // not through setInputDevice -- that would reset them, and they're still ours too.  copyStateFrom
+        //  leaves them alone
+        out->inputDevices[0] = inputDevices[0];
+        out->inputDevices[1] = inputDevices[1];
+
+        if(isFileLoaded())
+            out->copyStateFrom(*this);
+        return out;
+    }
+
     int Nes::getApproxNaturalAudioSize() const
     {
-        return audioBuilder->audioAvailableAtTimestamp( resetInfo->region.masterCyclesPerFrame );
+        return audioBuilder->audioAvailableAtTimestamp( audioBuilder->getTimeBase() + resetInfo->region.masterCyclesPerFrame );
     }
 
     int Nes::getAvailableAudioSize() const
@@ -283,36 +521,136 @@ namespace schcore
     ///////////////////////////////////////////////////////
     ///////////////////////////////////////////////////////
 
-    void Nes::doFrame()
+    void Nes::setRunAhead(int frames)
+    {
+        runAheadFrames = std::max(0, frames);
+        if(!runAheadFrames)
+            runAheadState = std::vector<u8>();
+    }
+
+    void Nes::setVideoTarget(void* mem, int pitch, VideoFormat format)
+    {
+        ppu->setVideoTarget(mem, pitch, format);
+    }
+
+    void Nes::setVideoPalette(const u8* rgb)
+    {
+        ppu->setVideoPalette(rgb);
+    }
+
+    const void* Nes::getVideoOutput(int& pitch, VideoFormat& format) const
+    {
+        std::ptrdiff_t p;
+        auto mem = ppu->getVideoOutput(p, format);
+        pitch = static_cast<int>(p);
+        return mem;
+    }
+
+    void Nes::setChrCacheEnabled(bool on)
+    {
+        ppuBus->setChrCacheEnabled(on);
+    }
+
+    bool Nes::isChrCacheEnabled() const
+    {
+        return ppuBus->isChrCacheEnabled();
+    }
+
+    std::size_t Nes::getMemoryUsage() const
+    {
+        std::size_t out =   sizeof(Nes) + sizeof(ResetInfo) + sizeof(Cpu) + sizeof(CpuBus) + sizeof(Ppu) + sizeof(PpuBus)
+                        +   sizeof(Apu) + sizeof(AudioBuilder) + sizeof(DmaUnit) + sizeof(CpuTracer) + sizeof(EventManager)
+                        +   sizeof(NsfDriver) + 0x0800;
+
+        out += apu->getMemoryUsage() + audioBuilder->getMemoryUsage() + runAheadState.capacity() + copyState.capacity();
+        if(ownedCartridge)
+            out += sizeof(Cartridge);       // (the mapper's own size isn't known here -- they're all small)
+        if(isFileLoaded())
+            out += cartridge->getMemoryUsage();
+
+        for(auto chips : { &loadedFile.prgRomChips, &loadedFile.prgRamChips, &loadedFile.chrRomChips, &loadedFile.chrRamChips })
+        {
+            for(auto& chip : *chips)
+            {
+                if(!chip.isShared())
+                    out += chip.getSize();
+            }
+        }
+        return out;
+    }
+
+    void Nes::doFrame(const FrameOptions& options)
     {
-        // TODO change behavior here for ROMs
         if(!isFileLoaded())     return;
 
+        apu->setAudioEnabled(options.audio);
+
+        // frames ahead only change the video -- so if nobody's going to see it, don't bother
+        if(!runAheadFrames || isNsf() || !options.video)
+        {
+            ppu->setVideoEnabled(options.video);
+            runFrame();
+            return;
+        }
+
+        // the real frame -- keep its audio, but its video will be replaced
+        ppu->setVideoEnabled(false);
+        runFrame();
+
+        runAheadState.resize( getStateSize() );
+        saveState( runAheadState.data(), runAheadState.size() );
+
+        // the frames ahead -- only keep the video of the last one
+        apu->setAudioEnabled(false);
+        for(int i = 0; i < runAheadFrames; ++i)
+        {
+            ppu->setVideoEnabled( i == runAheadFrames - 1 );
+            runFrame();
+        }
+        apu->setAudioEnabled(options.audio);
+
+        loadState( runAheadState.data(), runAheadState.size() );
+    }
+
+    void Nes::runFrame()
+    {
+        // TODO change behavior here for ROMs
+        const timestamp_t frameEnd = frameStart + clocksPerFrame;
+
         if(isNsf())
         {
-            cpu->run( clocksPerFrame );
-            apu->run( clocksPerFrame );
+            cpu->run( frameEnd );
+            apu->run( frameEnd );
             cpu->unjam();
-            
-            cpu->endFrame( clocksPerFrame );
-            apu->endFrame( clocksPerFrame );
+
+            if(monotonicTimeline)
+                frameStart = frameEnd;
+            else
+            {
+                cpu->endFrame( clocksPerFrame );
+                apu->endFrame( clocksPerFrame );
+                eventManager->subtractFromTimestamps( clocksPerFrame );
+            }
         }
         else
         {
-            timestamp_t run = clocksPerFrame;
-
-            cpu->run( run );
-            apu->run( run );
-            ppu->run( run );
-            cartridge->run( run );
-
-            run = ppu->finalizeFrame();
-            
-            cpu->endFrame( run );
-            apu->endFrame( run );
-            ppu->endFrame( run );
-            cartridge->endFrame( run );
-            eventManager->subtractFromTimestamps( run );
+            cpu->run( frameEnd );
+            apu->run( frameEnd );
+            ppu->run( frameEnd );
+            cartridge->run( frameEnd );
+
+            timestamp_t run = ppu->finalizeFrame();
+
+            if(monotonicTimeline)
+                frameStart += run;
+            else
+            {
+                cpu->endFrame( run );
+                apu->endFrame( run );
+                ppu->endFrame( run );
+                cartridge->endFrame( run );
+                eventManager->subtractFromTimestamps( run );
+            }
         }
     }
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 
 #include <stdexcept>
 #include <fstream>
+#include <cstring>
 #include "nesfile.h"
 
 namespace
@@ -57,6 +58,12 @@ namespace schcore
 
         return "";
     }
+
+    void NesFile::shareRom()
+    {
+        for(auto& chip : prgRomChips)       chip.share();
+        for(auto& chip : chrRomChips)       chip.share();
+    }
     
     ////////////////////////////////////////////////
     ////////////////////////////////////////////////
@@ -99,18 +99,24 @@ namespace schcore
                 swapPrg_32k(0x8,0,false);
             }
             
-            info.cpuBus->addReader( 0x3, 0x3, this, &NsfDriver::onReadNsfDriver );
-            info.cpuBus->addPeeker( 0x3, 0x3, this, &NsfDriver::onPeekNsfDriver );
+            info.cpuBus->addReader<NsfDriver, &NsfDriver::onReadNsfDriver>( 0x3, 0x3, this );
+            info.cpuBus->addPeeker<NsfDriver, &NsfDriver::onPeekNsfDriver>( 0x3, 0x3, this );
 
             // only add bankswitching regs to the bus if this nsf has bankswitching
             if(loadedFile->nsf_hasBankswitching)
-                info.cpuBus->addWriter( 0x5, 0x5, this, &NsfDriver::onWriteBankswap );
+                info.cpuBus->addWriter<NsfDriver, &NsfDriver::onWriteBankswap>( 0x5, 0x5, this );
         }
 
         for(auto& i : expansion)
             i->reset(info);
     }
 
+    void NsfDriver::cartSerialize(StateStream& s)
+    {
+        for(auto& i : expansion)
+            i->serialize(s);
+    }
+
     void NsfDriver::doNsfPrgSwap(int slot, u8 v)
     {
         if( isFdsTune() )
@@ -22,6 +22,7 @@ namespace schcore
     protected:
         virtual void            cartLoad(NesFile& file) override;
         virtual void            cartReset(const ResetInfo& info) override;
+        virtual void            cartSerialize(StateStream& s) override;
 
     private:
         static const int        driverCodeSize = 0x20;
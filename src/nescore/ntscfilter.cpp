@@ -0,0 +1,298 @@
+
+#include <cmath>
+#include <cstring>
+#include <cstdlib>
+#include <cstddef>
+#include <algorithm>
+#include "ntscfilter.h"
+#include "pixelformat.h"
+#include "error.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define SCHPUNE_NTSC_SSE2
+    #include <emmintrin.h>
+#endif
+
+namespace schcore
+{
+    namespace
+    {
+        //  The signal is simulated at the rate the PPU makes it:  8 samples per pixel, 12 per subcarrier cycle.
+        //  Every group of 3 NES pixels (24 samples) becomes 7 output pixels, so the pattern of where pixels land
+        //  repeats every group.  Each pixel's kernel spans all the output pixels its group can reach.
+        const int       groupPixels =   3;
+        const int       groupSamples =  24;
+        const int       groupOut =      7;
+        const int       groups =        (256 + groupPixels - 1) / groupPixels;
+        const int       tapBase =       -4;                     // kernels start this many output pixels before their group
+        const int       taps =          14;
+        const int       kernelFloats =  taps * 4;
+        const int       indexes =       0x200;
+        const int       accPixels =     groups * groupOut + taps;
+
+        const double    pi =            3.14159265358979323846;
+        const double    hueShift =      103;                    // lines the hues up with the built-in palette
+
+        // Signal levels (from the nesdev wiki), relative to sync
+        const float     levels[8] = {   0.350f, 0.518f, 0.962f, 1.550f,         // low
+                                        1.094f, 1.506f, 1.962f, 1.962f  };      // high
+        const float     black =         0.518f;
+        const float     white =         1.962f;
+        const float     attenuation =   0.746f;
+
+        bool inColorPhase(int color, int phase)     { return (color + phase) % 12 < 6;      }
+
+        // the signal for 'index' at this subcarrier phase (0-11).  0 is black, 1 is white
+        double signalLevel(int index, int phase)
+        {
+            int color =     index & 0x0F;
+            int level =     (index >> 4) & 3;
+            int emphasis =  index >> 6;
+
+            if(color > 13)      level = 1;
+            float lo = levels[level];
+            float hi = levels[level + 4];
+            if(color == 0)      lo = hi;
+            if(color > 12)      hi = lo;
+
+            float v = inColorPhase(color, phase) ? hi : lo;
+            if( ((emphasis & 1) && inColorPhase(0, phase)) ||
+                ((emphasis & 2) && inColorPhase(4, phase)) ||
+                ((emphasis & 4) && inColorPhase(8, phase)) )
+                v *= attenuation;
+
+            return (v - black) / (white - black);
+        }
+    }
+
+    ////////////////////////////////////////////////////
+
+    NtscFilter::NtscFilter(VideoFormat fmt, const NtscSettings& set)
+    {
+        if(fmt == VideoFormat::Index)
+            throw Error("The NTSC filter can only output RGB formats");
+
+        format = fmt;
+        setSettings(set);
+    }
+
+    void NtscFilter::setSettings(const NtscSettings& set)
+    {
+        if(set.width < 1)
+            throw Error("NTSC filter width must be at least 1");
+
+        settings = set;
+        build();
+    }
+
+    void NtscFilter::build()
+    {
+        // Decoding:  luma is the average over one subcarrier cycle (which cancels the chroma out of it exactly),
+        //  I and Q are demodulated over two cycles with a Hann window (which cancels luma out of them).
+        double hann[groupSamples];
+        for(int j = 0; j < groupSamples; ++j)
+            hann[j] = 0.5 - 0.5 * std::cos( 2 * pi * (j + 0.5) / groupSamples );
+
+        double cosine[12], sine[12];
+        const double hue = (settings.hue + hueShift) * pi / 180;
+        for(int p = 0; p < 12; ++p)
+        {
+            cosine[p] = std::cos( 2 * pi * (p + 0.5) / 12 + hue );
+            sine[p] =   std::sin( 2 * pi * (p + 0.5) / 12 + hue );
+        }
+
+        const int       fields =    settings.mergeFields ? 2 : 1;
+        const double    scale =     255.0 * settings.contrast / fields;
+        const double    chroma =    settings.saturation * 2 / 12;        // 12 is the sum of the window
+
+        kernels.assign( 3 * groupPixels * indexes * kernelFloats, 0.0f );
+        for(int rowphase = 0; rowphase < 3; ++rowphase)
+        {
+            for(int pos = 0; pos < groupPixels; ++pos)
+            {
+                for(int index = 0; index < indexes; ++index)
+                {
+                    float* k = &kernels[ ((rowphase * groupPixels + pos) * indexes + index) * kernelFloats ];
+                    for(int f = 0; f < fields; ++f)
+                    {
+                        const int phase = ((rowphase + f) % 3) * 4;      // subcarrier phase of the row's first sample
+                        for(int t = 0; t < taps; ++t)
+                        {
+                            const double c = (t + tapBase + 0.5) * groupSamples / groupOut;    // center, in samples
+                            const int ystart = static_cast<int>( std::floor(c - 6 + 0.5) );
+                            const int cstart = static_cast<int>( std::floor(c - 12 + 0.5) );
+                            double y = 0, i = 0, q = 0;
+
+                            for(int n = pos * 8; n < pos * 8 + 8; ++n)
+                            {
+                                const int p = (phase + n) % 12;
+                                const double s = signalLevel(index, p);
+                                if(n >= ystart && n < ystart + 12)
+                                    y += s;
+                                if(n >= cstart && n < cstart + groupSamples)
+                                {
+                                    i += s * hann[n - cstart] * cosine[p];
+                                    q += s * hann[n - cstart] * sine[p];
+                                }
+                            }
+                            y /= 12;
+                            i *= chroma;
+                            q *= chroma;
+
+                            k[t*4 + 0] += static_cast<float>( (y + 0.956 * i + 0.621 * q) * scale );
+                            k[t*4 + 1] += static_cast<float>( (y - 0.272 * i - 0.647 * q) * scale );
+                            k[t*4 + 2] += static_cast<float>( (y - 1.106 * i + 1.703 * q) * scale );
+                        }
+                    }
+                }
+            }
+        }
+
+        resample.clear();
+        if(settings.width != nativeWidth)
+        {
+            resample.resize( (settings.width + 3) & ~3 );
+            for(int x = 0; x < static_cast<int>(resample.size()); ++x)
+            {
+                double s = (x + 0.5) * nativeWidth / settings.width - 0.5;
+                s = std::min(std::max(s, 0.0), nativeWidth - 1.0);
+                resample[x].pos =   static_cast<int>(s);
+                resample[x].frac =  static_cast<float>(s - resample[x].pos);
+            }
+        }
+    }
+
+    ////////////////////////////////////////////////////
+    //  Filtering
+
+    void NtscFilter::filter(const u16* src, int srcpitch, void* dst, int dstpitch, int phase, int firstrow, int rows) const
+    {
+        const int bytes = (format == VideoFormat::RGB565) ? 2 : 4;
+        if(std::abs(dstpitch) < settings.width * bytes)
+            throw Error("NTSC filter output pitch is too small for its width");
+
+#if defined(SCHPUNE_NTSC_SSE2)
+        alignas(16) float acc[accPixels * 4];
+#else
+        float acc[accPixels * 4];
+#endif
+        const float bright = settings.brightness * 255;
+        u16 line[groups * groupPixels];
+        std::fill(line + 256, line + groups * groupPixels, static_cast<u16>(0x0F));       // black off the right edge
+
+        for(int row = firstrow; row < firstrow + rows; ++row)
+        {
+            std::memcpy( line, reinterpret_cast<const u8*>(src) + row * static_cast<std::ptrdiff_t>(srcpitch), 256 * sizeof(u16) );
+
+            for(int i = 0; i < accPixels; ++i)
+            {
+                acc[i*4 + 0] = acc[i*4 + 1] = acc[i*4 + 2] = bright;
+                acc[i*4 + 3] = 0;
+            }
+
+            const float* k = &kernels[ (((phase + row) % 3 + 3) % 3) * groupPixels * indexes * kernelFloats ];
+            for(int g = 0; g < groups; ++g)
+            {
+                const float* k0 = k + (              (line[g*3 + 0] & 0x1FF)) * kernelFloats;
+                const float* k1 = k + (indexes     + (line[g*3 + 1] & 0x1FF)) * kernelFloats;
+                const float* k2 = k + (indexes * 2 + (line[g*3 + 2] & 0x1FF)) * kernelFloats;
+                float* a = acc + g * groupOut * 4;
+
+#if defined(SCHPUNE_NTSC_SSE2)
+                for(int t = 0; t < kernelFloats; t += 4)
+                {
+                    __m128 s = _mm_add_ps( _mm_loadu_ps(k0 + t), _mm_add_ps(_mm_loadu_ps(k1 + t), _mm_loadu_ps(k2 + t)) );
+                    _mm_store_ps( a + t, _mm_add_ps(_mm_load_ps(a + t), s) );
+                }
+#else
+                for(int t = 0; t < kernelFloats; ++t)
+                    a[t] += k0[t] + k1[t] + k2[t];
+#endif
+            }
+
+            u8* out = static_cast<u8*>(dst) + row * static_cast<std::ptrdiff_t>(dstpitch);
+            switch(format)
+            {
+            case VideoFormat::RGBA8888:     writeRow<VideoFormat::RGBA8888>(out, acc);     break;
+            case VideoFormat::BGRA8888:     writeRow<VideoFormat::BGRA8888>(out, acc);     break;
+            case VideoFormat::RGB565:       writeRow<VideoFormat::RGB565>  (out, acc);     break;
+            default:                        break;
+            }
+        }
+    }
+
+    template <VideoFormat F>
+    void NtscFilter::writeRow(u8* out, const float* acc) const
+    {
+        typedef typename PixelFormat<F>::type   T;
+        const float* px = acc - tapBase * 4;            // output pixel 0
+        const int width = settings.width;
+
+#if defined(SCHPUNE_NTSC_SSE2)
+        auto fetch = [&] (int x) -> __m128i
+        {
+            __m128 v;
+            if(resample.empty())
+                v = _mm_load_ps(px + x*4);
+            else
+            {
+                const Resample& r = resample[x];
+                __m128 a = _mm_load_ps(px + r.pos*4);
+                __m128 b = _mm_load_ps(px + r.pos*4 + 4);
+                v = _mm_add_ps( a, _mm_mul_ps(_mm_sub_ps(b, a), _mm_set1_ps(r.frac)) );
+            }
+            if(F == VideoFormat::BGRA8888)
+                v = _mm_shuffle_ps(v, v, _MM_SHUFFLE(3,0,1,2));
+            return _mm_cvtps_epi32(v);
+        };
+
+        const __m128i alpha = _mm_set1_epi32( static_cast<int>(0xFF000000) );
+        alignas(16) u8 tmp[16];
+        for(int x = 0; x < width; x += 4)
+        {
+            __m128i lo = _mm_packs_epi32( fetch(x + 0), fetch(x + 1) );
+            __m128i hi = _mm_packs_epi32( fetch(x + 2), fetch(x + 3) );
+            __m128i v = _mm_or_si128( _mm_packus_epi16(lo, hi), alpha );       // 4 pixels as bytes, in memory order
+
+            if(sizeof(T) == 4 && x + 4 <= width)
+            {
+                _mm_storeu_si128( reinterpret_cast<__m128i*>(out + x*4), v );
+                continue;
+            }
+
+            _mm_store_si128( reinterpret_cast<__m128i*>(tmp), v );
+            const int n = std::min(4, width - x);
+            if(sizeof(T) == 4)
+                std::memcpy( out + x*4, tmp, n * 4 );
+            else
+            {
+                for(int i = 0; i < n; ++i)
+                {
+                    T p = PixelFormat<F>::make(0, tmp + i*4);
+                    std::memcpy( out + (x + i) * sizeof(T), &p, sizeof(T) );
+                }
+            }
+        }
+#else
+        auto toByte = [] (float v)  { return static_cast<u8>( std::min(std::max(v + 0.5f, 0.0f), 255.0f) );  };
+        for(int x = 0; x < width; ++x)
+        {
+            float v[3];
+            for(int c = 0; c < 3; ++c)
+            {
+                if(resample.empty())
+                    v[c] = px[x*4 + c];
+                else
+                {
+                    const Resample& r = resample[x];
+                    v[c] = px[r.pos*4 + c] + (px[r.pos*4 + 4 + c] - px[r.pos*4 + c]) * r.frac;
+                }
+            }
+
+            const u8 rgb[3] = { toByte(v[0]), toByte(v[1]), toByte(v[2]) };
+            T p = PixelFormat<F>::make(0, rgb);
+            std::memcpy( out + x * sizeof(T), &p, sizeof(T) );
+        }
+#endif
+    }
+}
@@ -0,0 +1,47 @@
+#ifndef SCHPUNE_NESCORE_PIXELFORMAT_H_INCLUDED
+#define SCHPUNE_NESCORE_PIXELFORMAT_H_INCLUDED
+
+#include <cstring>
+#include "schpunetypes.h"
+#include "videoformat.h"
+
+namespace schcore
+{
+    //////////////////////////////////////////////////
+    //  PixelFormat
+    //    What a pixel looks like in each VideoFormat.  The PPU only ever uses these to build its color table
+    //  (one entry per palette index + emphasis combination), so converting to the target format costs nothing
+    //  per pixel -- it just picks between the u16 and u32 tables.
+
+    template <VideoFormat F> struct PixelFormat;
+
+    template <> struct PixelFormat<VideoFormat::Index>
+    {
+        typedef u16     type;
+        static type     make(u16 index, const u8* /*rgb*/)  { return index;                                                 }
+    };
+
+    template <> struct PixelFormat<VideoFormat::RGBA8888>
+    {
+        typedef u32     type;
+        static type     make(u16 /*index*/, const u8* rgb)  { const u8 b[4] = { rgb[0], rgb[1], rgb[2], 0xFF };  return pack(b);    }
+        static type     pack(const u8* b)                   { type v;  std::memcpy(&v, b, 4);  return v;                    }
+    };
+
+    template <> struct PixelFormat<VideoFormat::BGRA8888>
+    {
+        typedef u32     type;
+        static type     make(u16 /*index*/, const u8* rgb)  { const u8 b[4] = { rgb[2], rgb[1], rgb[0], 0xFF };  return PixelFormat<VideoFormat::RGBA8888>::pack(b);   }
+    };
+
+    template <> struct PixelFormat<VideoFormat::RGB565>
+    {
+        typedef u16     type;
+        static type     make(u16 /*index*/, const u8* rgb)  { return static_cast<type>( ((rgb[0] >> 3) << 11) | ((rgb[1] >> 2) << 5) | (rgb[2] >> 3) );   }
+    };
+
+    // fills 'rgb' with 0x200 RGB triplets -- the built-in palette, with emphasis applied
+    void        buildDefaultPalette(u8* rgb);
+}
+
+#endif
@@ -1,5 +1,7 @@
 
 #include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include "ppu.h"
 #include "ppubus.h"
 #include "cpubus.h"
@@ -7,6 +9,10 @@
 #include "resetinfo.h"
 #include "cpu.h"
 #include "cputracer.h"
+#include "tiledecode.h"
+#include "chrcache.h"
+#include "pixelformat.h"
+#include "error.h"
 
 // TODO PPU Warm up time?   https://wiki.nesdev.com/w/index.php/PPU_power_up_state
 
@@ -21,6 +27,74 @@ namespace schcore
         nametables[0].writable = nametables[1].writable = &ChipPage::alwaysTrue;
 
         nametables[0].mask = nametables[1].mask = 0x03FF;
+
+        buildDefaultPalette(videoPalette);
+        setVideoTarget(nullptr, 0, VideoFormat::Index);
+    }
+
+    /////////////////////////////////////////////////////////////////////
+    //  Video target
+    namespace
+    {
+        template <VideoFormat F, typename T>
+        void fillColorTable(T* table, const u8* rgb)
+        {
+            for(int i = 0; i < 0x200; ++i)
+                table[i] = PixelFormat<F>::make( static_cast<u16>(i), rgb + i*3 );
+        }
+    }
+
+    void Ppu::setVideoTarget(void* mem, int pitch, VideoFormat format)
+    {
+        if(!mem)
+        {
+            mem = outputBuffer;
+            pitch = 256 * sizeof(u16);
+            format = VideoFormat::Index;
+        }
+
+        bool wide = (format == VideoFormat::RGBA8888 || format == VideoFormat::BGRA8888);
+        if(std::abs(pitch) < 256 * (wide ? 4 : 2))
+            throw Error("Video target pitch is too small for 256 pixels");
+
+        videoMem = static_cast<u8*>(mem);
+        videoPitch = pitch;
+        videoFormat = format;
+        videoWide = wide;
+        buildColorTable();
+    }
+
+    void Ppu::setVideoPalette(const u8* rgb)
+    {
+        if(rgb)     std::copy(rgb, rgb + sizeof(videoPalette), videoPalette);
+        else        buildDefaultPalette(videoPalette);
+        buildColorTable();
+    }
+
+    void Ppu::buildColorTable()
+    {
+        switch(videoFormat)
+        {
+        case VideoFormat::Index:        fillColorTable<VideoFormat::Index>      (colors16, videoPalette);   break;
+        case VideoFormat::RGBA8888:     fillColorTable<VideoFormat::RGBA8888>   (colors32, videoPalette);   break;
+        case VideoFormat::BGRA8888:     fillColorTable<VideoFormat::BGRA8888>   (colors32, videoPalette);   break;
+        case VideoFormat::RGB565:       fillColorTable<VideoFormat::RGB565>     (colors16, videoPalette);   break;
+        }
+    }
+
+    void Ppu::clearVideo()
+    {
+        int pos = pixel;
+        for(pixel = 0; pixel < 240*256; ++pixel)
+            putPixel(0x0F);
+        pixel = pos;
+    }
+
+    inline void Ppu::putPixel(u16 color)
+    {
+        u8* row = videoMem + (pixel >> 8) * videoPitch;
+        if(videoWide)   reinterpret_cast<u32*>(row)[pixel & 0xFF] = colors32[color];
+        else            reinterpret_cast<u16*>(row)[pixel & 0xFF] = colors16[color];
     }
 
     /////////////////////////////////////////////////////////////////////
@@ -52,9 +126,11 @@ namespace schcore
         regToggle =         false;
         addr =              0;
         
-        pixel =             outputBuffer;
+        pixel =             0;
         chrLoShift =        0;
         chrHiShift =        0;
+        atShift =           0;
+        spr0Hit =           false;
         ntFetch =           0;
         atFetch =           0;
         chrLoFetch =        0;
@@ -66,21 +142,24 @@ namespace schcore
 
             statusByte =            0;
             oamAddr =               0;
-            for(auto i : oam)       i = 0xFF;
+            for(auto& i : oam)      i = 0xFF;
 
             addrTemp =              0;
             fineX =                 0;
-            for(auto i : palette)   i = 0x0F;
+            for(auto& i : palette)  i = 0x0F;
 
             cpuBus = info.cpuBus;
             ppuBus = info.ppuBus;
             eventManager = info.eventManager;
+            nmiEvent = eventManager->createHandle(EventType::evt_ppu);
+            nmiEventSkipped = eventManager->createHandle(EventType::evt_ppu);
 
-            for(auto i : outputBuffer)  i = 0x0F;
-            for(auto i : sprPixels)     i = 0;
+            clearVideo();
+            for(auto& i : sprPixels)        i = 0;
+            for(auto& i : rawNametables)    i = 0;
             
-            cpuBus->addReader(0x2, 0x3, this, &Ppu::onRead);
-            cpuBus->addWriter(0x2, 0x3, this, &Ppu::onWrite);
+            cpuBus->addReader<Ppu, &Ppu::onRead>(0x2, 0x3, this);
+            cpuBus->addWriter<Ppu, &Ppu::onWrite>(0x2, 0x3, this);
             
             vblankCycles = 20 * 341 * info.region.ppuClockBase;     // TODO - do this smarter
             safeOamCycles = 20 * 341 * info.region.ppuClockBase;
@@ -234,18 +313,85 @@ namespace schcore
             case line_vbl:      tick = run_vblank(tick);                                                break;
             case line_post:     tick = run_postRenderLine(tick);                                        break;
             case line_pre:      tick = (renderOn ? run_line_On(tick) : run_preRenderLine_Off(tick));    break;
-            default:            tick = (renderOn ? run_line_On(tick) : run_renderLine_Off(tick));       break;
+            default:
+                if(!renderOn)                           tick = run_renderLine_Off(tick);
+                else if(scanCyc == 0 && tick >= 341)    tick = run_renderLine_Full(tick);
+                else                                    tick = run_line_On(tick);
+                break;
             }
         }
         catchingUp = false;
     }
 
+    /////////////////////////////////////////////////////////////////////
+    //  Save states
+    void Ppu::serialize(StateStream& s)
+    {
+        subSystem_Serialize(s);
+
+        s(regBus);
+        s(catchingUp);
+        s(scanline);
+        s.time(scanCyc);
+        s.time(vblankCycles);
+        s.time(safeOamCycles);
+        s(oddFrame);
+        s(oddCycSkipped);
+
+        s(nmiEnabled);
+        s(spriteSize);
+        s(bgPage);
+        s(spPage);
+        s(addrInc);
+
+        s(emphasis);
+        s(bgClip);
+        s(spClip);
+        s(pltMask);
+        s(renderOn);
+
+        s(statusByte);
+        s(suppressNmi);
+        s(oamAddr);
+        s(oam);
+        s(readBuffer);
+
+        s(regToggle);
+        s(addrTemp);
+        s(addr);
+        s(fineX);
+
+        s(palette);
+        s(rawNametables);
+        s(sprPixels);
+        if(s.isLoading())
+            spr0OnLine = std::any_of( std::begin(sprPixels), std::end(sprPixels), [] (u8 p) { return (p & 0x40) != 0; } );
+
+        s(chrLoShift);
+        s(chrHiShift);
+        s(atShift);
+        s(spr0Hit);
+        s(ntFetch);
+        s(atFetch);
+        s(chrLoFetch);
+        s(chrHiFetch);
+
+        int pix = pixel;
+        s(pix);
+        if(s.isLoading())
+        {
+            if(pix < 0 || pix > 240*256)
+                throw Error("Save state is corrupt (bad PPU pixel position)");
+            pixel = pix;
+        }
+    }
+
     //////////////////////////////////////
     //  VBlank
     timestamp_t Ppu::run_vblank(timestamp_t ticks)
     {
         // reset this here for good measure
-        pixel = outputBuffer;
+        pixel = 0;
 
         ///////////////////////////////////
         // Only thing interesting that happens in VBlank is setting the VBlank flag and
@@ -363,10 +509,37 @@ namespace schcore
 
         clrout = emphasis | (clrout & pltMask);     // emphasis and monochrome bits are still employed
 
-        while((ticks > 0) && (scanline < line_post))        // TODO, could this be optimized?
+        if(!videoEnabled)
+        {
+            // nothing to draw, so just skip ahead -- a line at a time, stopping for sprite evaluation
+            while((ticks > 0) && (scanline < line_post))
+            {
+                timestamp_t run = std::min<timestamp_t>( ticks, 341 - scanCyc );
+                if(scanCyc < 256)
+                    pixel += static_cast<int>( std::min<timestamp_t>( run, 256 - scanCyc ) );
+                if(scanCyc <= 256 && scanCyc + run > 256)
+                    buildSpritePixels();
+
+                cyc(static_cast<int>(run));
+                ticks -= run;
+                scanCyc += run;
+                if(scanCyc >= 341)
+                {
+                    scanCyc = 0;
+                    ++scanline;
+                }
+            }
+            return ticks;
+        }
+
+        // TODO -- this could fill whole runs of pixels at once, like the skip-ahead above
+        while((ticks > 0) && (scanline < line_post))
         {
             if(scanCyc < 256)
-                *pixel++ = clrout;
+            {
+                putPixel(clrout);
+                ++pixel;
+            }
 
             if(scanCyc == 256)
             {
@@ -398,6 +571,11 @@ namespace schcore
         timestamp_t cyclesRun = 0;        // ticks ran
         u16 a;
 
+        // the shifters have been shifted this many times since they were last loaded
+        if(scanCyc < 256)                           decodeBgWindow( scanCyc & 7 );
+        else if(scanCyc > 320 && scanCyc < 336)     decodeBgWindow( (scanCyc - 320) & 7 );
+        else                                        decodeBgWindow( 0 );
+
         while((cyclesRun < ticks) && (scanline < line_post))
         {
             //////////////////////////////////////////
@@ -436,6 +614,7 @@ namespace schcore
                 chrLoShift |= chrLoFetch;
                 chrHiShift |= chrHiFetch;
                 atShift = (atShift << 2) | atFetch;
+                decodeBgWindow(0);
                 break;
                 
             case   1: case   9: case  17: case  25: case  33: case  41: case  49: case  57:
@@ -482,18 +661,17 @@ namespace schcore
 
             //////////////////////////////////////////
             // do a pixel for cycs 0-255
-            if((scanCyc < 256) && (scanline >= 0))
+            if((scanCyc < 256) && (scanline >= 0) && !videoEnabled && !(spr0OnLine && !(statusByte & 0x40)))
             {
-                u8 bgpix = ((chrLoShift >> (15-fineX)) & 0x01)
-                         | ((chrHiShift >> (14-fineX)) & 0x02);
+                // not drawing, and sprite 0 can't hit -- nobody cares about this pixel
+                ++pixel;
+                chrLoShift <<= 1;
+                chrHiShift <<= 1;
+            }
+            else if((scanCyc < 256) && (scanline >= 0))
+            {
+                u8 bgpix = bgWindow[ (scanCyc & 7) + fineX ];
                 if(scanCyc < bgClip)        bgpix = 0;
-
-                // apply attributes
-                if(bgpix)
-                {
-                    if( ((scanCyc & 7) + fineX) & 8 )   bgpix |= (atShift << 2) & 0x0C;
-                    else                                bgpix |= atShift & 0x0C;
-                }
                 
                 ////////////////////////////////////////
                 // get sprite pixel
@@ -509,7 +687,8 @@ namespace schcore
                     bgpix = sprpix & 0x1F;
 
 
-                *pixel++ = emphasis | (palette[bgpix] & pltMask);
+                if(videoEnabled)    putPixel( emphasis | (palette[bgpix] & pltMask) );
+                ++pixel;
                 chrLoShift <<= 1;
                 chrHiShift <<= 1;
             }
@@ -528,6 +707,7 @@ namespace schcore
             {
                 scanCyc = 0;
                 ++scanline;
+                break;          // stop at the end of the line, so the next one can be run whole if possible
             }
         }
 
@@ -538,13 +718,142 @@ namespace schcore
         return ticks;
     }
 
+    //////////////////////////////////////
+    //  Render  (On, whole line)
+    //    If a whole render line is being run at once, nothing outside the PPU can happen partway through it --
+    //  register writes, CHR swaps, $2002 reads etc all catch the PPU up first, which would have split the line.
+    //  So instead of going dot by dot, this does all the line's fetches (in the same order as run_line_On, so
+    //  mappers that watch them see the same thing), then draws all the pixels, and leaves every register just
+    //  as run_line_On would have.
+
+    timestamp_t Ppu::run_renderLine_Full(timestamp_t ticks)
+    {
+        if(scanline == 0)
+            statusByte = 0;
+
+        /////////////////////////////////////////
+        //  Tiles 0 and 1 were fetched at the end of the previous line and are sitting in the shifters.  The
+        //    other 32 (including the one that's only partly visible when fineX is nonzero) get fetched now.
+        u64 px[34];
+        u8  at[34];                                 // (already in place for the pixels -- bits 2,3)
+        px[0] = tiledecode::spread( static_cast<u8>(chrLoShift >> 8), static_cast<u8>(chrHiShift >> 8) );      at[0] = atShift & 0x0C;
+        px[1] = tiledecode::spread( static_cast<u8>(chrLoShift),      static_cast<u8>(chrHiShift) );           at[1] = (atShift << 2) & 0x0C;
+
+        if(ChrCache* cache = ppuBus->getChrCache())
+        {
+            // nothing's watching CHR reads, so those come straight from the cache
+            for(int t = 2; t < 34; ++t)
+            {
+                fetchBgNtAt();
+                px[t] = cache->row( bgPage | (ntFetch<<4) | ((addr >> 12) & 7) );
+                at[t] = atFetch << 2;
+                incX();
+            }
+        }
+        else
+        {
+            for(int t = 2; t < 34; ++t)
+            {
+                fetchBgTile();
+                px[t] = tiledecode::spread( chrLoFetch, chrHiFetch );
+                at[t] = atFetch << 2;
+            }
+        }
+        incY();
+
+        /////////////////////////////////////////
+        //  Pixels -- sprPixels still holds this line's sprites (they're rebuilt for the next line below)
+        u8  bg[34 * 8];
+        tiledecode::attribute( bg, px, at, 34 );
+        u8* bgpixels = bg + fineX;
+        std::fill_n( bgpixels, std::min(bgClip, 256), u8(0) );
+
+        const u8* sppixels = sprPixels;
+        u8  sp[256];
+        if(spClip)
+        {
+            std::fill_n( sp, std::min(spClip, 256), u8(0) );
+            if(spClip < 256)
+                std::copy( sprPixels + spClip, sprPixels + 256, sp + spClip );
+            sppixels = sp;
+        }
+
+        //sprite 0 hit?
+        if(spr0OnLine && !(statusByte & 0x40))
+        {
+            for(int x = 0; x < 255; ++x)
+            {
+                if(bgpixels[x] && (sppixels[x] & 0x40))
+                {
+                    statusByte |= 0x40;
+                    break;
+                }
+            }
+        }
+
+        if(videoEnabled)
+        {
+            if(videoWide)       drawLine(bgpixels, sppixels, colors32);
+            else                drawLine(bgpixels, sppixels, colors16);
+        }
+        pixel += 256;
+
+        /////////////////////////////////////////
+        //  Dot 256 on:  sprites for the next line, then the first two tiles of the next line
+        buildSpritePixels();
+        resetX();
+
+        fetchBgTile();
+        u8 loA = chrLoFetch, hiA = chrHiFetch, atA = atFetch;
+        fetchBgTile();
+
+        ntFetch = ppuBus->read(0x2000 | (addr & 0x0FFF));       // the two dummy fetches at 337 and 339
+        ntFetch = ppuBus->read(0x2000 | (addr & 0x0FFF));
+
+        chrLoShift =    (loA << 8) | chrLoFetch;
+        chrHiShift =    (hiA << 8) | chrHiFetch;
+        atShift =       static_cast<u8>( (at[32] << 4) | (at[33] << 2) | (atA << 2) | atFetch );
+
+        cyc(341);
+        ++scanline;
+        return ticks - 341;
+    }
+
+    template <typename Pixel>
+    void Ppu::drawLine(const u8* bgpixels, const u8* sppixels, const Pixel* table)
+    {
+        // the line's 32 colors, already in the target's format
+        Pixel colors[0x20];
+        for(int i = 0; i < 0x20; ++i)
+            colors[i] = table[ emphasis | (palette[i] & pltMask) ];
+
+        Pixel* dst = reinterpret_cast<Pixel*>( videoMem + (pixel >> 8) * videoPitch );
+        const u64 lowBits = 0x0101010101010101ULL;
+        for(int x = 0; x < 256; x += 8)
+        {
+            // which pixel to use?  sprite if the bg is transparent or the sprite has priority
+            u64 bgpix, sprpix;
+            std::memcpy(&bgpix, bgpixels + x, 8);
+            std::memcpy(&sprpix, sppixels + x, 8);
+
+            u64 usespr = (~(bgpix | (bgpix >> 1)) | (sprpix >> 7)) & lowBits;
+            u64 mask = usespr * 0xFF;
+            u8  out[8];
+            u64 idx = (bgpix & ~mask) | (sprpix & mask & (lowBits * 0x1F));
+            std::memcpy(out, &idx, 8);
+
+            for(int i = 0; i < 8; ++i)
+                dst[x + i] = colors[out[i]];
+        }
+    }
+
     //////////////////////////////////////////////
     //  Other stuff
     
     timestamp_t Ppu::finalizeFrame()
     {
         oddFrame = !oddFrame;
-        pixel = outputBuffer;
+        pixel = 0;
 
         auto out = getMaxFrameLength();
         if(oddCycSkipped)
@@ -575,6 +884,25 @@ namespace schcore
         else                                ++addr;
     }
 
+    inline void Ppu::fetchBgNtAt()
+    {
+        ntFetch = ppuBus->read(0x2000 | (addr & 0x0FFF));
+
+        u16 a = 0x23C0 | ((addr >> 2) & 0x0007) | ((addr >> 4) & 0x0038) | (addr & 0x0C00);
+        atFetch = ppuBus->read(a);
+        if(addr & 0x0002)   atFetch >>= 2;
+        if(addr & 0x0040)   atFetch >>= 4;
+        atFetch &= 0x03;
+    }
+
+    inline void Ppu::fetchBgTile()
+    {
+        fetchBgNtAt();
+        chrLoFetch = ppuBus->read( bgPage | (ntFetch<<4) | ((addr >> 12) & 7) );
+        chrHiFetch = ppuBus->read( bgPage | (ntFetch<<4) | ((addr >> 12) & 7) | 0x0008 );
+        incX();
+    }
+
     inline void Ppu::incY()
     {
         if((addr & 0x7000) == 0x7000)
@@ -628,10 +956,15 @@ namespace schcore
 
             ///////////////////////////
             // Add the event at this timestamp
-            eventManager->addEvent( evt, EventType::evt_ppu );
+            eventManager->setEvent( nmiEvent, evt );
 
             // and also at time-1 in case the odd cycle is skipped
-            eventManager->addEvent( evt - getClockBase(), EventType::evt_ppu );                          // TODO don't do this on PAL since there are no skipped cycles?
+            eventManager->setEvent( nmiEventSkipped, evt - getClockBase() );                         // TODO don't do this on PAL since there are no skipped cycles?
+        }
+        else
+        {
+            eventManager->cancelEvent( nmiEvent );
+            eventManager->cancelEvent( nmiEventSkipped );
         }
     }
 
@@ -642,12 +975,14 @@ namespace schcore
     {
         // TODO -- this entire routine is temporary.  Replace this with actual OAM evaluation logic
         for(auto& i : sprPixels)        i = 0;      // TODO -- this is temporary
+        spr0OnLine = false;
 
         if(!renderOn) return;
 
         int spritesfound = 0;
         u16 a;
         u8 at;
+        ChrCache* cache = ppuBus->getChrCache();
 
         for(int i = 0; i < 256; i += 4)
         {
@@ -683,35 +1018,42 @@ namespace schcore
             at  = (oam[i+2] << 2) & 0x8C;
             at ^= 0x80;                     // flip priority bit (makes drawing logic easier)
             at |= 0x10;                     // sprites always use the 1x palette
-            if(!i)      at |= 0x40;         //sprite 0
-
-            u8 lo = ppuBus->read(a);
-            u8 hi = ppuBus->read(a | 8);
+            if(!i)                          //sprite 0
+            {
+                at |= 0x40;
+                spr0OnLine = true;
+            }
 
-            // h-flip
-            u8* dst = &sprPixels[ oam[i+3] ];
-            if(oam[i+2] & 0x40)
+            bool hflip = (oam[i+2] & 0x40) != 0;
+            u64 px;
+            if(cache)
             {
-                if(!dst[0])     if(dst[0] = ((hi << 1) & 2) | ((lo     ) & 1))      dst[0] |= at;
-                if(!dst[1])     if(dst[1] = ((hi     ) & 2) | ((lo >> 1) & 1))      dst[1] |= at;
-                if(!dst[2])     if(dst[2] = ((hi >> 1) & 2) | ((lo >> 2) & 1))      dst[2] |= at;
-                if(!dst[3])     if(dst[3] = ((hi >> 2) & 2) | ((lo >> 3) & 1))      dst[3] |= at;
-                if(!dst[4])     if(dst[4] = ((hi >> 3) & 2) | ((lo >> 4) & 1))      dst[4] |= at;
-                if(!dst[5])     if(dst[5] = ((hi >> 4) & 2) | ((lo >> 5) & 1))      dst[5] |= at;
-                if(!dst[6])     if(dst[6] = ((hi >> 5) & 2) | ((lo >> 6) & 1))      dst[6] |= at;
-                if(!dst[7])     if(dst[7] = ((hi >> 6) & 2) | ((lo >> 7) & 1))      dst[7] |= at;
+                px = cache->row(a);
+                if(hflip)   px = tiledecode::mirror(px);
             }
             else
             {
-                if(!dst[0])     if(dst[0] = ((hi >> 6) & 2) | ((lo >> 7) & 1))      dst[0] |= at;
-                if(!dst[1])     if(dst[1] = ((hi >> 5) & 2) | ((lo >> 6) & 1))      dst[1] |= at;
-                if(!dst[2])     if(dst[2] = ((hi >> 4) & 2) | ((lo >> 5) & 1))      dst[2] |= at;
-                if(!dst[3])     if(dst[3] = ((hi >> 3) & 2) | ((lo >> 4) & 1))      dst[3] |= at;
-                if(!dst[4])     if(dst[4] = ((hi >> 2) & 2) | ((lo >> 3) & 1))      dst[4] |= at;
-                if(!dst[5])     if(dst[5] = ((hi >> 1) & 2) | ((lo >> 2) & 1))      dst[5] |= at;
-                if(!dst[6])     if(dst[6] = ((hi     ) & 2) | ((lo >> 1) & 1))      dst[6] |= at;
-                if(!dst[7])     if(dst[7] = ((hi << 1) & 2) | ((lo     ) & 1))      dst[7] |= at;
+                u8 lo = ppuBus->read(a);
+                u8 hi = ppuBus->read(a | 8);
+                px = tiledecode::spread(lo, hi, hflip);
             }
+
+            // earlier sprites have priority, so this one only fills in the gaps
+            u8 out[8];
+            tiledecode::attribute( out, &px, &at, 1 );
+            tiledecode::under( &sprPixels[ oam[i+3] ], out );
         }
     }
+
+    inline void Ppu::decodeBgWindow(int shifted)
+    {
+        // 'shifted' bits have gone out the top of the shifters since they were loaded, but those pixels have all
+        //   been drawn already (fineX only looks further ahead), so the rest just gets decoded where it was
+        u16 lo = chrLoShift >> shifted;
+        u16 hi = chrHiShift >> shifted;
+        u64 px[2] = { tiledecode::spread( static_cast<u8>(lo >> 8), static_cast<u8>(hi >> 8) ),
+                      tiledecode::spread( static_cast<u8>(lo),      static_cast<u8>(hi) ) };
+        u8  at[2] = { static_cast<u8>(atShift & 0x0C), static_cast<u8>((atShift << 2) & 0x0C) };
+        tiledecode::attribute( bgWindow, px, at, 2 );
+    }
 }
\ No newline at end of file
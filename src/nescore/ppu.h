@@ -2,9 +2,12 @@
 #ifndef SCHPUNE_NESCORE_PPU_H_INCLUDED
 #define SCHPUNE_NESCORE_PPU_H_INCLUDED
 
+#include <cstddef>
 #include "schpunetypes.h"
 #include "subsystem.h"
 #include "memorychip.h"
+#include "eventmanager.h"
+#include "videoformat.h"
 
 
 namespace schcore
@@ -22,6 +25,7 @@ namespace schcore
         //  Resetting
                             Ppu();
         void                reset(const ResetInfo& info);
+        void                serialize(StateStream& s);      // (the video buffer isn't included)
 
         //////////////////////////////////////////////////
         //  Detecting the length of the frame we just ran (for timestamp adjustment)
@@ -33,7 +37,12 @@ namespace schcore
         virtual void        run(timestamp_t runto) override;
 
 
-        const u16*          getVideo() const            { return outputBuffer;          }
+        const u16*          getVideo() const            { return usingOwnBuffer() ? outputBuffer : nullptr;     }
+        const u8*           getVideoOutput(std::ptrdiff_t& pitch, VideoFormat& format) const
+                                                        { pitch = videoPitch;   format = videoFormat;   return videoMem;    }
+        void                setVideoEnabled(bool on)    { videoEnabled = on;            }   // when off, pixels aren't output (everything else still happens)
+        void                setVideoTarget(void* mem, int pitch, VideoFormat format);       // null 'mem' to go back to outputBuffer
+        void                setVideoPalette(const u8* rgb);                                 // 0x200 RGB triplets, or null for the built-in one
         ChipPage            getNt(int v)                { return nametables[v != 0];    }
 
     private:
@@ -94,16 +103,37 @@ namespace schcore
         CpuBus*             cpuBus = nullptr;
         PpuBus*             ppuBus = nullptr;
         EventManager*       eventManager = nullptr;
-
-        u16                 outputBuffer[240 * 256];
-        u16*                pixel;
+        EventManager::handle_t  nmiEvent;
+        EventManager::handle_t  nmiEventSkipped;       // for when the odd frame's skipped cycle puts it 1 earlier
+
+        u16                 outputBuffer[240 * 256];        // drawn to when there's no video target
+        int                 pixel;                          // position in the frame (y*256 + x)
+        bool                videoEnabled = true;
+
+        //  video target -- pixels go out through the color table, which is already in the target's format
+        u8*                 videoMem;
+        std::ptrdiff_t      videoPitch;
+        VideoFormat         videoFormat;
+        bool                videoWide;                      // 4 byte pixels (colors32), otherwise 2 (colors16)
+        u8                  videoPalette[0x200 * 3];
+        u16                 colors16[0x200];                // index+emphasis -> pixel
+        u32                 colors32[0x200];
+
+        bool                usingOwnBuffer() const      { return videoMem == reinterpret_cast<const u8*>(outputBuffer);    }
+        void                buildColorTable();
+        void                clearVideo();
+        void                putPixel(u16 color);            // at 'pixel' (which isn't moved)
+        template <typename Pixel>
+        void                drawLine(const u8* bgpixels, const u8* sppixels, const Pixel* table);
 
         u8                  sprPixels[256 + 8];             // $40 = spr 0, $80 = high prio
+        bool                spr0OnLine = false;             // some pixel in sprPixels is $40 (not saved -- rebuilt from sprPixels)
 
         //  output shifters
         u16                 chrLoShift;
         u16                 chrHiShift;
         u8                  atShift;
+        u8                  bgWindow[16];                   // the shifters decoded (not saved -- run_line_On rebuilds it)
 
         bool                spr0Hit;
         u8                  ntFetch;
@@ -114,6 +144,9 @@ namespace schcore
         void                incX();
         void                incY();
         void                resetX();
+        void                fetchBgNtAt();
+        void                fetchBgTile();
+        void                decodeBgWindow(int shifted);
 
         ///////////////////////////////////////////////////////
         //  running!
@@ -121,6 +154,7 @@ namespace schcore
         timestamp_t         run_postRenderLine(timestamp_t ticks);
         timestamp_t         run_preRenderLine_Off(timestamp_t ticks);
         timestamp_t         run_line_On(timestamp_t ticks);
+        timestamp_t         run_renderLine_Full(timestamp_t ticks);     // a whole render line at once (when it's all being run)
         timestamp_t         run_renderLine_Off(timestamp_t ticks);
 
 
@@ -4,20 +4,7 @@
 
 namespace schcore
 {
-    // TODO -- all of this
-    void PpuBus::write(u16 a, u8 v)
-    {
-        ioDevice->onPpuWrite(a, v);
-    }
-
-    u8 PpuBus::read(u16 a)
-    {
-        // TODO simulate bus?
-        u8 v = 0;
-        ioDevice->onPpuRead(a, v);
-        return v;
-    }
-
+    // TODO -- all of this (simulate bus?)
     void PpuBus::reset(const ResetInfo& info)
     {
         if(info.hardReset)
@@ -11,6 +11,7 @@
 namespace schcore
 {
     class ResetInfo;
+    class ChrCache;
 
     class PpuIo
     {
@@ -23,15 +24,23 @@ namespace schcore
     class PpuBus
     {
     public:
-        void        write(u16 a, u8 v);
-        u8          read(u16 a);
+        void        write(u16 a, u8 v)      { ioDevice->onPpuWrite(a, v);           }
+        u8          read(u16 a)             { u8 v = 0;  ioDevice->onPpuRead(a, v);  return v;      }
 
         void        reset(const ResetInfo& info);
 
         void        setIoDevice(PpuIo* device)      { ioDevice = device;        }
 
+        // CHR reads can skip the io device and come from a cache, if the device offers one (see chrcache.h)
+        void        setChrCache(ChrCache* cache)    { chrCache = cache;         }
+        void        setChrCacheEnabled(bool on)     { chrCacheEnabled = on;     }
+        bool        isChrCacheEnabled() const       { return chrCacheEnabled;   }
+        ChrCache*   getChrCache() const             { return chrCacheEnabled ? chrCache : nullptr;  }
+
     private:
         PpuIo*      ioDevice;
+        ChrCache*   chrCache = nullptr;
+        bool        chrCacheEnabled = true;
     };
 
 
@@ -0,0 +1,173 @@
+
+#include <cstring>
+#include "rewinder.h"
+#include "nes.h"
+
+namespace schcore
+{
+    namespace
+    {
+        // Delta format:  a series of runs, each is:
+        //      u16     number of unchanged bytes to skip
+        //      u16     number of changed bytes that follow
+        //      u8[]    the changed bytes (XOR of old and new)
+
+        const std::size_t   maxRun =            0xFFFF;
+        const std::size_t   matchesToEndRun =   4;          // it's cheaper to skip this many unchanged bytes than to store them
+
+        inline void put16(std::vector<u8>& out, std::size_t v)
+        {
+            out.push_back( static_cast<u8>(v) );
+            out.push_back( static_cast<u8>(v >> 8) );
+        }
+
+        inline std::size_t get16(const u8*& p)
+        {
+            std::size_t v = p[0] | (p[1] << 8);
+            p += 2;
+            return v;
+        }
+
+        void encodeDelta(const u8* a, const u8* b, std::size_t size, std::vector<u8>& out)
+        {
+            out.clear();
+
+            std::size_t pos = 0;
+            while(pos < size)
+            {
+                // skip unchanged bytes -- 8 at a time while we can
+                std::size_t start = pos;
+                u64 wa, wb;
+                while(pos + 8 <= size)
+                {
+                    std::memcpy(&wa, a + pos, 8);
+                    std::memcpy(&wb, b + pos, 8);
+                    if(wa != wb)    break;
+                    pos += 8;
+                }
+                while(pos < size && a[pos] == b[pos])
+                    ++pos;
+                if(pos >= size)
+                    break;
+
+                std::size_t skip = pos - start;
+                while(skip > maxRun)
+                {
+                    put16(out, maxRun);
+                    put16(out, 0);
+                    skip -= maxRun;
+                }
+
+                // then the changed bytes, up until a few unchanged bytes in a row
+                std::size_t end = pos;
+                while(end < size && end - pos < maxRun - matchesToEndRun)
+                {
+                    if(a[end] != b[end])
+                    {
+                        ++end;
+                        continue;
+                    }
+                    std::size_t m = end;
+                    while(m < size && m - end < matchesToEndRun && a[m] == b[m])
+                        ++m;
+                    if(m == size || m - end == matchesToEndRun)
+                        break;
+                    end = m;
+                }
+
+                put16(out, skip);
+                put16(out, end - pos);
+                for(; pos < end; ++pos)
+                    out.push_back( a[pos] ^ b[pos] );
+            }
+        }
+
+        void applyDelta(const std::vector<u8>& delta, std::vector<u8>& state)
+        {
+            const u8* p =   delta.data();
+            const u8* end = p + delta.size();
+            u8* dst =       state.data();
+
+            while(p < end)
+            {
+                dst +=      get16(p);
+                auto len =  get16(p);
+                for(std::size_t i = 0; i < len; ++i)
+                    dst[i] ^= p[i];
+                dst += len;
+                p += len;
+            }
+        }
+    }
+
+    Rewinder::Rewinder(Nes& n, int maxframes, std::size_t memorybudget)
+        : nes(n)
+        , maxFrames(maxframes)
+        , memBudget(memorybudget)
+    {
+    }
+
+    void Rewinder::clear()
+    {
+        history.clear();
+        head.clear();
+        memUsed = 0;
+    }
+
+    void Rewinder::dropOldest(std::vector<u8>& recycle)
+    {
+        memUsed -= history.front().data.capacity();
+        if(recycle.capacity() < history.front().data.capacity())
+            recycle.swap( history.front().data );
+        history.pop_front();
+    }
+
+    void Rewinder::capture()
+    {
+        // the state size only changes if settings change, so this is normally only sized once
+        std::size_t size = nes.getStateSize();
+        scratch.resize(size);
+        nes.saveState(scratch.data(), size);
+
+        if(head.empty())
+        {
+            head.swap(scratch);
+            return;
+        }
+
+        // make room first, so the oldest entry's memory can be reused for the new one
+        std::vector<u8> buf;
+        while(!history.empty() && (getFrameCount() >= maxFrames || getMemoryUsage() >= memBudget))
+            dropOldest(buf);
+
+        Entry e;
+        e.data.swap(buf);
+        e.whole = (head.size() != scratch.size());
+        if(e.whole)     e.data.assign( head.begin(), head.end() );
+        else            encodeDelta( head.data(), scratch.data(), size, e.data );
+
+        // a reused buffer might be left over from something much bigger (a whole state, a scene change) --
+        //  don't let that keep counting against the budget for every frame after
+        if(e.data.capacity() > e.data.size() * 2 + 256)
+            e.data.shrink_to_fit();
+
+        memUsed += e.data.capacity();
+        history.push_back( std::move(e) );
+        head.swap(scratch);
+    }
+
+    bool Rewinder::stepBack()
+    {
+        if(history.empty())
+            return false;
+
+        auto& e = history.back();
+        memUsed -= e.data.capacity();
+        if(e.whole)     head.swap(e.data);
+        else            applyDelta(e.data, head);
+        history.pop_back();
+
+        nes.loadState(head.data(), head.size());
+        return true;
+    }
+}
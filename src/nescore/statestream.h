@@ -0,0 +1,87 @@
+#ifndef SCHPUNE_NESCORE_STATESTREAM_H_INCLUDED
+#define SCHPUNE_NESCORE_STATESTREAM_H_INCLUDED
+
+#include <cstring>
+#include <type_traits>
+#include "schpunetypes.h"
+#include "error.h"
+
+namespace schcore
+{
+    //////////////////////////////////////////////////
+    //  StateStream
+    //    Moves save state data between a flat buffer and the emulator's members.  Every class has a single
+    //  serialize() function which handles saving and loading both -- it just calls the stream on each of its
+    //  members in a fixed order -- so the two directions can't drift apart.
+    //
+    //    Everything is stored at a fixed size in host byte order.  Types whose size varies between builds
+    //  (timestamp_t, irqsource_t, enums) must go through as<>() or time() so the layout is always the same:
+    //
+    //      s(counter);                 // u8/u16/int/bool/etc are stored as-is
+    //      s.time(scanCyc);            // timestamps are always stored as 64-bit
+    //      s.as<u8>(adsr);             // enums, etc
+    //      s.bytes(oam, sizeof(oam));  // raw memory
+
+    class StateStream
+    {
+    public:
+        enum class Mode
+        {   Measure, Save, Load  };         // Measure just counts how big the state would be (buffer can be null)
+
+        StateStream(Mode m, u8* buffer, std::size_t size)
+            : mode(m), buf(buffer), bufSize(m == Mode::Measure ? ~std::size_t(0) : size)
+        {}
+
+        bool                isLoading() const           { return mode == Mode::Load;    }
+        std::size_t         getSize() const             { return pos;                   }
+
+        void                bytes(void* p, std::size_t n)
+        {
+            if(bufSize - pos < n)
+                throw Error( isLoading() ? "Save state data is truncated" : "Save state buffer is too small" );
+
+            if(mode == Mode::Load)          std::memcpy(p, buf + pos, n);
+            else if(mode == Mode::Save)     std::memcpy(buf + pos, p, n);
+            pos += n;
+        }
+
+        void                skip(std::size_t n)         // loading only -- for data that can't be used
+        {
+            if(bufSize - pos < n)
+                throw Error( "Save state data is truncated" );
+            pos += n;
+        }
+
+        template <typename T>
+        void                operator () (T& v)
+        {
+            static_assert(std::is_arithmetic<T>::value, "Only fixed size arithmetic types can be streamed directly -- use as<>()");
+            bytes(&v, sizeof(T));
+        }
+
+        template <typename T, std::size_t N>
+        void                operator () (T (&v)[N])
+        {
+            static_assert(std::is_arithmetic<T>::value, "Only fixed size arithmetic types can be streamed directly -- use as<>()");
+            bytes(v, sizeof(v));
+        }
+
+        template <typename Stored, typename T>
+        void                as(T& v)
+        {
+            Stored x = static_cast<Stored>(v);
+            (*this)(x);
+            if(isLoading())     v = static_cast<T>(x);
+        }
+
+        void                time(timestamp_t& v)        { as<s64>(v);                           }
+
+    private:
+        Mode                mode;
+        u8*                 buf;
+        std::size_t         bufSize;
+        std::size_t         pos = 0;
+    };
+}
+
+#endif
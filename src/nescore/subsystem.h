@@ -3,6 +3,7 @@
 #define SCHPUNE_NESCORE_SUBSYSTEM_H_INCLUDED
 
 #include "schpunetypes.h"
+#include "statestream.h"
 
 
 namespace schcore
@@ -39,10 +40,12 @@ namespace schcore
             drivingClock = drivingclock;
         }
 
+        void            subSystem_Serialize(StateStream& s)     { s.time(timestamp);    }
+
     private:
-        timestamp_t     timestamp;
-        timestamp_t     clockBase;
-        SubSystem*      drivingClock;
+        timestamp_t     timestamp = 0;
+        timestamp_t     clockBase = 1;
+        SubSystem*      drivingClock = nullptr;
     };
 
 
@@ -0,0 +1,28 @@
+
+#include "tiledecode.h"
+
+namespace schcore
+{
+    namespace tiledecode
+    {
+        namespace detail
+        {
+            Tables::Tables()
+            {
+                for(int i = 0; i < 0x100; ++i)
+                {
+                    u8 normal[8], flipped[8];
+                    for(int k = 0; k < 8; ++k)
+                    {
+                        normal[k] =  (i >> (7-k)) & 1;
+                        flipped[k] = (i >> k) & 1;
+                    }
+                    std::memcpy( &spread[0][i], normal, 8 );
+                    std::memcpy( &spread[1][i], flipped, 8 );
+                }
+            }
+
+            const Tables    tables;
+        }
+    }
+}
@@ -0,0 +1,115 @@
+#ifndef SCHPUNE_NESCORE_TILEDECODE_H_INCLUDED
+#define SCHPUNE_NESCORE_TILEDECODE_H_INCLUDED
+
+#include <cstring>
+#include "schpunetypes.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define SCHPUNE_TILEDECODE_SSE2
+    #include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+    #define SCHPUNE_TILEDECODE_NEON
+    #include <arm_neon.h>
+#endif
+
+namespace schcore
+{
+    //////////////////////////////////////////////////
+    //  tiledecode
+    //    Turns 2bpp CHR rows (a lo and hi plane byte) into pixels -- one byte per pixel, left to right.  It's done in
+    //  two steps:  spread() gives the 8 bare 2-bit colors packed in a u64 (the form the CHR cache keeps them in),
+    //  and attribute() writes them out with 'attr' ORed into the opaque ones, so transparent pixels always come
+    //  out 0.  'attr' can be any bits that leave the low 2 alone (bg palette bits, or a sprite's palette/priority/
+    //  spr0 bits).
+    //
+    //    The planes are spread out with lookup tables (one for each h-flip), so a row is just a couple of ORs.  The
+    //  attribute/merge work is done with SSE2 or NEON when they're around, and 8 pixels at a time in a u64 when
+    //  they aren't.  Nothing carries between bytes, and the tables are built in memory order, so endianness
+    //  doesn't matter.
+
+    namespace tiledecode
+    {
+        u64     spread(u8 lo, u8 hi, bool hflip = false);                                   // 8 pixels, 0-3 each
+        u64     mirror(u64 px);                                                             // h-flip spread pixels
+        void    attribute(u8* dst, const u64* px, const u8* attr, int count);               // 'count' rows of 8 pixels out
+        void    under(u8* dst, const u8* src);                                              // 8 pixels: 'src' only fills in where 'dst' is transparent
+
+        namespace detail
+        {
+            struct Tables
+            {
+                u64     spread[2][0x100];       // [hflip][plane byte] -> each bit in its own byte, in pixel order
+                Tables();
+            };
+            extern const Tables     tables;
+
+            const u64   lowBits = 0x0101010101010101ULL;
+
+            inline u64 load(const void* p)              { u64 v; std::memcpy(&v, p, 8); return v;   }
+            inline void store(void* p, u64 v)           { std::memcpy(p, &v, 8);                    }
+        }
+
+        ////////////////////////////////////////////////
+
+        inline u64 spread(u8 lo, u8 hi, bool hflip)
+        {
+            const u64* t = detail::tables.spread[hflip];
+            return t[lo] | (t[hi] << 1);
+        }
+
+        inline u64 mirror(u64 px)
+        {
+            // reversing the bytes of the value reverses them in memory too, whichever way round the machine is
+            px = ((px >>  8) & 0x00FF00FF00FF00FFULL) | ((px & 0x00FF00FF00FF00FFULL) <<  8);
+            px = ((px >> 16) & 0x0000FFFF0000FFFFULL) | ((px & 0x0000FFFF0000FFFFULL) << 16);
+            return (px >> 32) | (px << 32);
+        }
+
+        inline void attribute(u8* dst, const u64* px, const u8* attr, int count)
+        {
+#if defined(SCHPUNE_TILEDECODE_SSE2)
+            const __m128i zero = _mm_setzero_si128();
+            for(; count >= 2; count -= 2, dst += 16, px += 2, attr += 2)
+            {
+                u64 a[2] = { detail::lowBits * attr[0], detail::lowBits * attr[1] };
+                __m128i p  = _mm_loadu_si128( reinterpret_cast<const __m128i*>(px) );
+                __m128i at = _mm_loadu_si128( reinterpret_cast<const __m128i*>(a) );
+                __m128i clear = _mm_cmpeq_epi8( p, zero );
+                _mm_storeu_si128( reinterpret_cast<__m128i*>(dst), _mm_or_si128(p, _mm_andnot_si128(clear, at)) );
+            }
+#elif defined(SCHPUNE_TILEDECODE_NEON)
+            for(; count > 0; --count, dst += 8, ++px, ++attr)
+            {
+                uint8x8_t p = vld1_u8( reinterpret_cast<const u8*>(px) );
+                uint8x8_t opaque = vtst_u8( p, p );
+                vst1_u8( dst, vorr_u8( p, vand_u8(opaque, vdup_n_u8(*attr)) ) );
+            }
+#endif
+            for(; count > 0; --count, dst += 8, ++px, ++attr)
+            {
+                u64 opaque = (*px | (*px >> 1)) & detail::lowBits;
+                detail::store( dst, *px | (opaque * *attr) );
+            }
+        }
+
+        inline void under(u8* dst, const u8* src)
+        {
+#if defined(SCHPUNE_TILEDECODE_SSE2)
+            __m128i d = _mm_loadl_epi64( reinterpret_cast<const __m128i*>(dst) );
+            __m128i s = _mm_loadl_epi64( reinterpret_cast<const __m128i*>(src) );
+            d = _mm_or_si128( d, _mm_and_si128(_mm_cmpeq_epi8(d, _mm_setzero_si128()), s) );
+            _mm_storel_epi64( reinterpret_cast<__m128i*>(dst), d );
+#elif defined(SCHPUNE_TILEDECODE_NEON)
+            uint8x8_t d = vld1_u8(dst);
+            vst1_u8( dst, vorr_u8( d, vand_u8(vceq_u8(d, vdup_n_u8(0)), vld1_u8(src)) ) );
+#else
+            const u64 high = 0x7F7F7F7F7F7F7F7FULL;
+            u64 d = detail::load(dst);
+            u64 empty = ~(((d & high) + high) | d | high);        // $80 in each byte of 'd' that's zero
+            detail::store( dst, d | (detail::load(src) & ((empty >> 7) * 0xFF)) );
+#endif
+        }
+    }
+}
+
+#endif